@@ -0,0 +1,165 @@
+#ifndef _bench_h_
+#define _bench_h_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "telehash.h"
+#include "version.h"
+
+// each bench binary prints one json document to stdout:
+// {"suite":"lib","version":"3.2.0","cflags":"-O2 ..","allocs":true,"results":[{"name":"lob_parse","size":64,"threads":1,"iters":..,"ns_op":..,"ops_sec":..,"allocs_op":..},..]}
+// BENCH_MS in the environment sets how long each case runs for (default 200), BENCH_THREADS the most threads used (default all cpus)
+
+// numbers from a debug build aren't worth printing, bench/Makefile compiles the library and these the same way
+#if defined(DEBUG) || !defined(__OPTIMIZE__) || !defined(BENCH_CFLAGS)
+#error "benches must be built by bench/Makefile, optimized and without DEBUG"
+#endif
+
+// runs iters of whatever is being measured
+typedef void (*bench_f)(void *arg, uint64_t iters);
+
+static uint64_t bench_allocs = 0;
+static int bench_count = 0;
+
+#ifdef BENCH_ALLOCS
+// the Makefile links with --wrap for these so every allocation in the library is counted
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+#define BENCH_ALLOC() __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED)
+void *__wrap_malloc(size_t size) { BENCH_ALLOC(); return __real_malloc(size); }
+void *__wrap_calloc(size_t n, size_t size) { BENCH_ALLOC(); return __real_calloc(n, size); }
+void *__wrap_realloc(void *ptr, size_t size) { BENCH_ALLOC(); return __real_realloc(ptr, size); }
+#endif
+
+static void bench_begin(const char *suite)
+{
+  util_sys_logging(0);
+  printf("{\"suite\":\"%s\",\"version\":\"%d.%d.%d\",\"cflags\":\"%s\",\"allocs\":%s,\"results\":[",suite,
+    TELEHASH_VERSION_MAJOR,TELEHASH_VERSION_MINOR,TELEHASH_VERSION_PATCH,BENCH_CFLAGS,
+#ifdef BENCH_ALLOCS
+    "true");
+#else
+    "false");
+#endif
+}
+
+static int bench_end(void)
+{
+  printf("\n]}\n");
+  fflush(stdout);
+  return 0;
+}
+
+// doubles the iterations until a run is long enough to scale from, returns how many fill the full length
+static uint64_t bench_calibrate(bench_f fn, void *arg)
+{
+  uint64_t target, iters = 1, start, took;
+  char *ms = getenv("BENCH_MS");
+  target = (uint64_t)((ms && atoi(ms) > 0) ? atoi(ms) : 200) * 1000000;
+
+  for(;;)
+  {
+    start = util_sys_ns();
+    fn(arg, iters);
+    took = util_sys_ns() - start;
+    if(took >= target / 10 || iters >= (1ULL << 40)) break;
+    iters *= 2;
+  }
+  if(took < target) iters = (uint64_t)((double)iters * target / (took ? took : 1));
+  return iters ? iters : 1;
+}
+
+// iters is the total across all threads, took the wall time
+static void bench_report(const char *name, uint32_t size, uint32_t threads, uint64_t iters, uint64_t took, uint64_t allocs)
+{
+  printf("%s\n  {\"name\":\"%s\",\"size\":%u,\"threads\":%u,\"iters\":%llu,\"ns_op\":%.1f,\"ops_sec\":%.0f,\"allocs_op\":%.2f}",
+    bench_count++ ? "," : "", name, size, threads, (unsigned long long)iters,
+    (double)took / iters, took ? (double)iters * 1e9 / took : 0.0, (double)allocs / iters);
+  fflush(stdout);
+}
+
+static void bench_run(const char *name, uint32_t size, bench_f fn, void *arg)
+{
+  uint64_t iters, start, took, allocs;
+
+  iters = bench_calibrate(fn, arg);
+  allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+  start = util_sys_ns();
+  fn(arg, iters);
+  took = util_sys_ns() - start;
+  bench_report(name, size, 1, iters, took, __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED) - allocs);
+}
+
+// how many threads bench_threads() callers should set up for
+static uint32_t bench_max_threads(void)
+{
+  char *env = getenv("BENCH_THREADS");
+  long n = (env && atoi(env) > 0) ? atoi(env) : sysconf(_SC_NPROCESSORS_ONLN);
+  if(n < 1) n = 1;
+  if(n > 64) n = 64;
+  return (uint32_t)n;
+}
+
+typedef struct bench_thread_struct
+{
+  bench_f fn;
+  void *arg;
+  uint64_t iters;
+} bench_thread_s;
+
+static void *bench_thread(void *arg)
+{
+  bench_thread_s *t = arg;
+  t->fn(t->arg, t->iters);
+  return NULL;
+}
+
+// the same case on each of threads at once, every one with its own arg, reports the combined rate
+static void bench_threads(const char *name, uint32_t size, bench_f fn, void **args, uint32_t threads)
+{
+  bench_thread_s runs[64];
+  pthread_t ids[64];
+  uint64_t iters, start, took, allocs;
+  uint32_t i;
+  if(threads < 2)
+  {
+    bench_run(name, size, fn, args[0]);
+    return;
+  }
+  if(threads > 64) threads = 64;
+
+  iters = bench_calibrate(fn, args[0]);
+  allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+  start = util_sys_ns();
+  for(i = 0; i < threads; i++)
+  {
+    runs[i].fn = fn;
+    runs[i].arg = args[i];
+    runs[i].iters = iters;
+    if(pthread_create(&ids[i], NULL, bench_thread, &runs[i])) break;
+  }
+  threads = i;
+  for(i = 0; i < threads; i++) pthread_join(ids[i], NULL);
+  took = util_sys_ns() - start;
+  bench_report(name, size, threads, iters * threads, took, __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED) - allocs);
+}
+
+// fills a packet with a typical json head and a body of the given size
+static lob_t bench_packet(uint32_t size)
+{
+  lob_t packet = lob_new();
+  lob_set_uint(packet,"c",42);
+  lob_set_uint(packet,"seq",1234);
+  lob_set(packet,"type","stream");
+  lob_set_raw(packet,"miss",0,"[1,2,3]",0);
+  lob_body(packet,NULL,size);
+  memset(lob_body_get(packet),0x42,size);
+  return packet;
+}
+
+#endif
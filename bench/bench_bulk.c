@@ -0,0 +1,198 @@
+#include <getopt.h>
+#include "bench.h"
+#include "net_loopback.h"
+
+// echoes packets between a mesh and its peers like test/net_bulk.c, but through queued loopback pairs so
+// any number can be in flight, and times the whole mesh_receive -> chan -> chan_send -> link_send path
+//   -s payload bytes (default 1024, at least 8)   -c channels per link (1)   -l links (1)
+//   -w packets in flight (1)   -n round trips (20000)   -b packets per pair per delivery (NET_LOOPBACK_BATCH)
+
+static uint32_t payload = 1024, rounds = 20000, sent = 0, received = 0, batch = NET_LOOPBACK_BATCH, links = 1;
+static uint64_t *rtts = NULL;
+static net_loopback_t *pairs = NULL;
+
+// delivers everything, including whatever gets sent while delivering, a batch per pair at a time
+static void bulk_pump(void)
+{
+  uint32_t i, count;
+  do
+  {
+    for(count = i = 0; i < links; i++) if(pairs[i]) count += net_loopback_process(pairs[i], batch);
+  }while(count);
+}
+
+// a sequenced packet stamped with when it left
+static void bulk_out(chan_t c)
+{
+  lob_t packet = chan_packet(c);
+  uint64_t now = util_sys_ns();
+  lob_body(packet, NULL, payload);
+  memset(lob_body_get(packet), 0x42, payload);
+  memcpy(lob_body_get(packet), &now, 8);
+  sent++;
+  chan_send(c, packet);
+}
+
+// peers send everything straight back
+static void bulk_echo(chan_t c, void *arg)
+{
+  lob_t packet;
+  while((packet = chan_receiving(c)))
+  {
+    if(lob_get(packet, "type") || lob_body_len(packet) < 8)
+    {
+      lob_free(packet);
+      continue;
+    }
+    chan_send(c, packet);
+  }
+}
+
+static lob_t bulk_on_open(link_t link, lob_t open)
+{
+  chan_t c;
+  if(lob_get_cmp(open, "type", "bulk")) return open;
+  c = link_chan(link, open);
+  chan_handle(c, bulk_echo, NULL);
+  chan_receive(c, open);
+  return NULL;
+}
+
+// the originating side records the round trip and keeps its channel's share in flight
+static void bulk_back(chan_t c, void *arg)
+{
+  lob_t packet;
+  uint64_t at;
+  while((packet = chan_receiving(c)))
+  {
+    if(lob_body_len(packet) >= 8)
+    {
+      memcpy(&at, lob_body_get(packet), 8);
+      if(received < rounds) rtts[received] = util_sys_ns() - at;
+      received++;
+      if(sent < rounds) bulk_out(c);
+    }
+    lob_free(packet);
+  }
+}
+
+static int bulk_cmp(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+// of the sorted round trips
+static uint64_t bulk_percentile(uint32_t count, uint32_t q)
+{
+  uint64_t at = ((uint64_t)count * q + 999) / 1000;
+  if(!count) return 0;
+  return rtts[at ? at - 1 : 0];
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t channels = 1, window = 1, i, j, k;
+  mesh_t meshA, *peers;
+  link_t *linkAB;
+  chan_t *chans;
+  lob_t *opens;
+  uint64_t start, took, allocs;
+  uint32_t done;
+  int opt;
+
+  while((opt = getopt(argc, argv, "s:c:l:w:n:b:")) != -1)
+  {
+    switch(opt)
+    {
+      case 's': payload = (uint32_t)atoi(optarg); break;
+      case 'c': channels = (uint32_t)atoi(optarg); break;
+      case 'l': links = (uint32_t)atoi(optarg); break;
+      case 'w': window = (uint32_t)atoi(optarg); break;
+      case 'n': rounds = (uint32_t)atoi(optarg); break;
+      case 'b': batch = (uint32_t)atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-s payload] [-c channels] [-l links] [-w in flight] [-n round trips] [-b batch]\n", argv[0]);
+        return 1;
+    }
+  }
+  if(payload < 8) payload = 8;
+  if(!channels) channels = 1;
+  if(!links) links = 1;
+  if(!window) window = 1;
+  if(!rounds) rounds = 1;
+  if(!batch) batch = 1;
+  if(window > rounds) window = rounds;
+
+  bench_begin("bulk");
+  e3x_init(NULL);
+
+  // one mesh paired with each peer
+  meshA = mesh_new();
+  lob_free(mesh_generate(meshA));
+  peers = malloc(links * sizeof(mesh_t));
+  linkAB = malloc(links * sizeof(link_t));
+  pairs = calloc(links, sizeof(net_loopback_t));
+  for(i = 0; i < links; i++)
+  {
+    peers[i] = mesh_new();
+    lob_free(mesh_generate(peers[i]));
+    mesh_on_open(peers[i], "bulk", bulk_on_open);
+    pairs[i] = net_loopback_queued(meshA, peers[i]);
+    linkAB[i] = link_get(meshA, peers[i]->id);
+    bulk_pump();
+    if(!link_up(linkAB[i]))
+    {
+      fprintf(stderr, "link %u didn't come up\n", i);
+      return 1;
+    }
+  }
+
+  // the opens are kept since channels point into them
+  chans = malloc(links * channels * sizeof(chan_t));
+  opens = malloc(links * channels * sizeof(lob_t));
+  for(k = i = 0; i < links; i++) for(j = 0; j < channels; j++, k++)
+  {
+    opens[k] = lob_new();
+    lob_set(opens[k], "type", "bulk");
+    chans[k] = link_chan(linkAB[i], opens[k]);
+    chan_handle(chans[k], bulk_back, NULL);
+    chan_send(chans[k], lob_copy(opens[k]));
+  }
+  bulk_pump();
+
+  rtts = malloc(rounds * sizeof(uint64_t));
+  util_trace_reset();
+  allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+  start = util_sys_ns();
+  for(i = 0; i < window; i++) bulk_out(chans[i % (links * channels)]);
+  bulk_pump();
+  took = util_sys_ns() - start;
+  allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED) - allocs;
+  if(received != rounds) fprintf(stderr, "only %u of %u came back\n", received, rounds);
+  done = received < rounds ? received : rounds;
+  if(!done || !took) return 1;
+
+  qsort(rtts, done, sizeof(uint64_t), bulk_cmp);
+  lob_t stages = util_trace_snapshot();
+  printf("\n  {\"name\":\"echo\",\"size\":%u,\"channels\":%u,\"links\":%u,\"window\":%u,\"batch\":%u,\"rounds\":%u,\"received\":%u,"
+    "\"packets_sec\":%.0f,\"mb_sec\":%.2f,\"rtt_p50\":%llu,\"rtt_p99\":%llu,\"rtt_p999\":%llu,\"allocs_packet\":%.2f,\"stages\":%s}",
+    payload, channels, links, window, batch, rounds, received,
+    (double)received * 2 * 1e9 / took, (double)received * 2 * payload * 1e3 / took,
+    (unsigned long long)bulk_percentile(done, 500), (unsigned long long)bulk_percentile(done, 990), (unsigned long long)bulk_percentile(done, 999),
+    (double)allocs / (done * 2), lob_json(stages));
+  lob_free(stages);
+
+  for(i = 0; i < links; i++) mesh_free(peers[i]);
+  mesh_free(meshA);
+  for(i = 0; i < links; i++) net_loopback_free(pairs[i]);
+  free(pairs);
+  for(k = 0; k < links * channels; k++) lob_free(opens[k]);
+  free(opens);
+  free(chans);
+  free(peers);
+  free(linkAB);
+  free(rtts);
+
+  return bench_end();
+}
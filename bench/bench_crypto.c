@@ -0,0 +1,256 @@
+#include "bench.h"
+#include "jwt.h"
+
+// channel payloads from a bare ack up to a full MTU
+static const uint32_t sizes[] = {64, 512, 1400};
+#define SIZES (sizeof(sizes)/sizeof(sizes[0]))
+
+// the same lanes the cipher sets batch in
+#define BATCH 8
+
+// everything one thread needs to drive a cipher set, two parties A and B with a channel each way
+typedef struct bench_cs_struct
+{
+  e3x_cipher_t cs;
+  lob_t secretsA, secretsB, keyA, keyB;
+  local_t localA;
+  local_t localB;
+  remote_t remoteA;
+  remote_t remoteB;
+  lob_t handshake, outerAB, outerBA;
+  ephemeral_t ephemAB;
+  ephemeral_t ephemBA;
+  lob_t inner, couter, inners;
+  e3x_self_t self;
+  e3x_exchange_t x;
+  lob_t token;
+} bench_cs_s;
+
+static lob_t bench_keys(e3x_cipher_t cs)
+{
+  lob_t secrets = lob_new();
+  lob_t keys = lob_new();
+  if(cs->generate(keys, secrets))
+  {
+    lob_free(keys);
+    return lob_free(secrets);
+  }
+  lob_link(secrets, keys);
+  return secrets;
+}
+
+static bench_cs_s *bench_cs_new(e3x_cipher_t cs)
+{
+  bench_cs_s *b = malloc(sizeof(bench_cs_s));
+  memset(b, 0, sizeof(bench_cs_s));
+  b->cs = cs;
+  if(!(b->secretsA = bench_keys(cs)) || !(b->secretsB = bench_keys(cs))) return LOG_ERROR("%s generate failed",cs->hex);
+  b->keyA = lob_get_base32(lob_linked(b->secretsA), cs->hex);
+  b->keyB = lob_get_base32(lob_linked(b->secretsB), cs->hex);
+  b->localA = cs->local_new(lob_linked(b->secretsA), b->secretsA);
+  b->localB = cs->local_new(lob_linked(b->secretsB), b->secretsB);
+  b->remoteA = cs->remote_new(b->keyA, NULL);
+  b->remoteB = cs->remote_new(b->keyB, NULL);
+  if(!b->localA || !b->localB || !b->remoteA || !b->remoteB) return LOG_ERROR("%s key load failed",cs->hex);
+
+  // a handshake each way sets up the channel keys
+  b->handshake = lob_new();
+  lob_set_uint(b->handshake, "at", 1);
+  b->outerAB = cs->remote_encrypt(b->remoteB, b->localA, b->handshake);
+  b->outerBA = cs->remote_encrypt(b->remoteA, b->localB, b->handshake);
+  if(!b->outerAB || !b->outerBA) return LOG_ERROR("%s handshake failed",cs->hex);
+  b->ephemBA = cs->ephemeral_new(b->remoteA, b->outerAB);
+  b->ephemAB = cs->ephemeral_new(b->remoteB, b->outerBA);
+  if(!b->ephemAB || !b->ephemBA) return LOG_ERROR("%s ephemeral failed",cs->hex);
+  return b;
+}
+
+// the channel packets for one payload size
+static void bench_cs_size(bench_cs_s *b, uint32_t size)
+{
+  uint32_t i;
+  lob_free(b->inner);
+  lob_free(b->couter);
+  lob_freeall(b->inners);
+  b->inners = NULL;
+  b->inner = bench_packet(size);
+  b->couter = b->cs->ephemeral_encrypt(b->ephemBA, b->inner);
+  for(i = 0; i < BATCH; i++) b->inners = lob_push(b->inners, lob_copy(b->inner));
+}
+
+static void run_generate(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  while(iters--) lob_free(bench_keys(b->cs));
+}
+
+static void run_local_decrypt(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  while(iters--) lob_free(b->cs->local_decrypt(b->localB, b->outerAB));
+}
+
+static void run_remote_encrypt(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  while(iters--) lob_free(b->cs->remote_encrypt(b->remoteB, b->localA, b->handshake));
+}
+
+static void run_remote_verify(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  uint64_t bad = 0;
+  while(iters--) if(b->cs->remote_verify(b->remoteA, b->localB, b->outerAB)) bad++;
+  if(bad) LOG_ERROR("verify failed");
+}
+
+static void run_ephemeral_new(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  while(iters--) b->cs->ephemeral_free(b->cs->ephemeral_new(b->remoteA, b->outerAB));
+}
+
+static void run_ephemeral_encrypt(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  while(iters--) lob_free(b->cs->ephemeral_encrypt(b->ephemBA, b->inner));
+}
+
+// decrypting takes over the outer's buffer, so each one works on a copy (included in the time)
+static void run_ephemeral_decrypt(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  lob_t outer;
+  uint64_t bad = 0;
+  while(iters--)
+  {
+    outer = lob_copy(b->couter);
+    if(!lob_free(b->cs->ephemeral_decrypt(b->ephemAB, outer))) bad++;
+    lob_free(outer);
+  }
+  if(bad) LOG_ERROR("decrypt failed");
+}
+
+static void run_ephemeral_encrypt_batch(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  while(iters--) lob_freeall(b->cs->ephemeral_encrypt_batch(b->ephemBA, b->inners));
+}
+
+static void run_ephemeral_decrypt_batch(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  lob_t outers;
+  uint32_t i;
+  while(iters--)
+  {
+    for(outers = NULL, i = 0; i < BATCH; i++) outers = lob_push(outers, lob_copy(b->couter));
+    lob_freeall(b->cs->ephemeral_decrypt_batch(b->ephemAB, outers));
+    lob_freeall(outers);
+  }
+}
+
+static void run_jwt_sign(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  while(iters--) jwt_sign(b->token, b->self);
+}
+
+static void run_jwt_verify(void *arg, uint64_t iters)
+{
+  bench_cs_s *b = arg;
+  uint64_t bad = 0;
+  while(iters--) if(!jwt_verify(b->token, b->x)) bad++;
+  if(bad) LOG_ERROR("jwt verify failed");
+}
+
+// each case once on one thread and then on all of them
+static void bench_both(const char *name, uint32_t size, bench_f fn, bench_cs_s **b, uint32_t threads)
+{
+  bench_run(name, size, fn, b[0]);
+  if(threads > 1) bench_threads(name, size, fn, (void**)b, threads);
+}
+
+static void bench_cs(e3x_cipher_t cs, uint32_t threads)
+{
+  bench_cs_s *b[64] = {NULL};
+  char name[64];
+  uint32_t i, s;
+
+  for(i = 0; i < threads; i++) if(!(b[i] = bench_cs_new(cs))) return;
+
+  snprintf(name, sizeof(name), "cs%s_generate", cs->hex);
+  bench_both(name, 0, run_generate, b, threads);
+  snprintf(name, sizeof(name), "cs%s_remote_encrypt", cs->hex);
+  bench_both(name, lob_len(b[0]->handshake), run_remote_encrypt, b, threads);
+  snprintf(name, sizeof(name), "cs%s_local_decrypt", cs->hex);
+  bench_both(name, lob_len(b[0]->outerAB), run_local_decrypt, b, threads);
+  snprintf(name, sizeof(name), "cs%s_remote_verify", cs->hex);
+  bench_both(name, lob_len(b[0]->outerAB), run_remote_verify, b, threads);
+  snprintf(name, sizeof(name), "cs%s_ephemeral_new", cs->hex);
+  bench_both(name, 0, run_ephemeral_new, b, threads);
+
+  for(s = 0; s < SIZES; s++)
+  {
+    for(i = 0; i < threads; i++) bench_cs_size(b[i], sizes[s]);
+    snprintf(name, sizeof(name), "cs%s_ephemeral_encrypt", cs->hex);
+    bench_both(name, sizes[s], run_ephemeral_encrypt, b, threads);
+    snprintf(name, sizeof(name), "cs%s_ephemeral_decrypt", cs->hex);
+    bench_both(name, sizes[s], run_ephemeral_decrypt, b, threads);
+    if(cs->ephemeral_encrypt_batch)
+    {
+      snprintf(name, sizeof(name), "cs%s_ephemeral_encrypt_batch%d", cs->hex, BATCH);
+      bench_both(name, sizes[s], run_ephemeral_encrypt_batch, b, threads);
+    }
+    if(cs->ephemeral_decrypt_batch)
+    {
+      snprintf(name, sizeof(name), "cs%s_ephemeral_decrypt_batch%d", cs->hex, BATCH);
+      bench_both(name, sizes[s], run_ephemeral_decrypt_batch, b, threads);
+    }
+  }
+}
+
+// jwt over whichever cipher set supports the alg, self and exchange set up per thread
+static void bench_jwt(char *alg, uint32_t threads)
+{
+  bench_cs_s *b[64] = {NULL};
+  char name[32];
+  e3x_cipher_t cs;
+  uint32_t i;
+
+  if(!jwt_alg(alg) || !(cs = e3x_cipher_set(0, alg))) return;
+  for(i = 0; i < threads; i++)
+  {
+    if(!(b[i] = bench_cs_new(cs))) return;
+    b[i]->self = e3x_self_new(b[i]->secretsA, NULL);
+    b[i]->x = e3x_exchange_new(b[i]->self, cs->csid, b[i]->keyA);
+    b[i]->token = lob_new();
+    lob_set(b[i]->token, "alg", alg);
+    lob_set(b[i]->token, "typ", "JWT");
+    lob_t claims = lob_new();
+    lob_set_int(claims, "sub", 42);
+    lob_set(claims, "iss", "bench");
+    lob_link(b[i]->token, claims);
+    if(!b[i]->self || !b[i]->x || !jwt_sign(b[i]->token, b[i]->self)) return;
+  }
+
+  snprintf(name, sizeof(name), "jwt_sign_%s", alg);
+  bench_both(name, 0, run_jwt_sign, b, threads);
+  snprintf(name, sizeof(name), "jwt_verify_%s", alg);
+  bench_both(name, 0, run_jwt_verify, b, threads);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t threads = bench_max_threads();
+  int i;
+
+  if(e3x_init(NULL)) return 1;
+  bench_begin("crypto");
+
+  for(i = 0; i < CS_MAX; i++) if(e3x_cipher_sets[i]) bench_cs(e3x_cipher_sets[i], threads);
+  bench_jwt("ES256", threads);
+  bench_jwt("HS256", threads);
+
+  return bench_end();
+}
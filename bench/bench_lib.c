@@ -0,0 +1,186 @@
+#include "bench.h"
+
+// body sizes from a bare ack up to past a typical MTU
+static const uint32_t sizes[] = {64, 512, 1400, 4096};
+#define SIZES (sizeof(sizes)/sizeof(sizes[0]))
+
+typedef struct bench_data_struct
+{
+  lob_t packet;
+  uint8_t *raw;
+  size_t len;
+  char *json;
+  char key[16];
+  xht_t xht;
+  char (*keys)[16];
+  uint32_t count;
+} bench_data_s;
+
+static void run_lob_parse(void *arg, uint64_t iters)
+{
+  bench_data_s *d = arg;
+  while(iters--) lob_free(lob_parse(d->raw, d->len));
+}
+
+static void run_lob_direct(void *arg, uint64_t iters)
+{
+  bench_data_s *d = arg;
+  uint8_t *raw;
+  while(iters--)
+  {
+    raw = malloc(d->len);
+    memcpy(raw, d->raw, d->len);
+    lob_free(lob_direct(raw, d->len));
+  }
+}
+
+static void run_lob_get(void *arg, uint64_t iters)
+{
+  bench_data_s *d = arg;
+  uint64_t found = 0;
+  while(iters--) if(lob_get(d->packet, "type")) found++;
+  if(!found) LOG("missing");
+}
+
+static void run_lob_set(void *arg, uint64_t iters)
+{
+  bench_data_s *d = arg;
+  while(iters--) lob_set_uint(d->packet, "seq", (unsigned int)iters);
+}
+
+static void run_js0n(void *arg, uint64_t iters)
+{
+  bench_data_s *d = arg;
+  size_t vlen;
+  uint64_t found = 0;
+  size_t klen = strlen(d->key), jlen = strlen(d->json);
+  while(iters--) if(js0n(d->key, klen, d->json, jlen, &vlen)) found++;
+  if(!found) LOG("missing");
+}
+
+static void run_xht_set(void *arg, uint64_t iters)
+{
+  bench_data_s *d = arg;
+  uint64_t i;
+  for(i = 0; i < iters; i++) xht_set(d->xht, d->keys[i % d->count], d);
+}
+
+static void run_xht_get(void *arg, uint64_t iters)
+{
+  bench_data_s *d = arg;
+  uint64_t i, found = 0;
+  for(i = 0; i < iters; i++) if(xht_get(d->xht, d->keys[i % d->count])) found++;
+  if(!found) LOG("missing");
+}
+
+// one packet out through a sender's frames and back together on a receiver's
+static void run_frames(void *arg, uint64_t iters)
+{
+  bench_data_s *d = arg;
+  util_frames_t tx = util_frames_new(42, 1024);
+  util_frames_t rx = util_frames_new(42, 1024);
+  uint8_t *frame;
+  uint32_t len;
+  while(iters--)
+  {
+    util_frames_send(tx, lob_copy(d->packet));
+    while((frame = util_frames_outbox(tx, &len)))
+    {
+      util_frames_inbox(rx, frame, len);
+      util_frames_sent(tx);
+    }
+    lob_free(util_frames_receive(rx));
+  }
+  util_frames_free(tx);
+  util_frames_free(rx);
+}
+
+// the same over a stream of chunks
+static void run_chunks(void *arg, uint64_t iters)
+{
+  bench_data_s *d = arg;
+  util_chunks_t tx = util_chunks_new(0);
+  util_chunks_t rx = util_chunks_new(0);
+  uint32_t len;
+  tx->blocking = 0;
+  while(iters--)
+  {
+    util_chunks_send(tx, lob_copy(d->packet));
+    while((len = util_chunks_len(tx)))
+    {
+      util_chunks_read(rx, util_chunks_write(tx), len);
+      util_chunks_written(tx, len);
+    }
+    lob_free(util_chunks_receive(rx));
+  }
+  util_chunks_free(tx);
+  util_chunks_free(rx);
+}
+
+// a json object of about size bytes of short string values
+static char *bench_json(uint32_t size, char *last)
+{
+  char *json = malloc(size + 32);
+  uint32_t at = 1, n = 0;
+  json[0] = '{';
+  while(at < size)
+  {
+    sprintf(last, "key%u", n);
+    at += sprintf(json + at, "%s\"%s\":\"value%u\"", n ? "," : "", last, n);
+    n++;
+  }
+  json[at++] = '}';
+  json[at] = 0;
+  return json;
+}
+
+int main(int argc, char **argv)
+{
+  bench_data_s d;
+  uint32_t i, k;
+
+  bench_begin("lib");
+  memset(&d, 0, sizeof(d));
+
+  for(i = 0; i < SIZES; i++)
+  {
+    d.packet = bench_packet(sizes[i]);
+    d.raw = lob_raw(d.packet);
+    d.len = lob_len(d.packet);
+    bench_run("lob_parse", sizes[i], run_lob_parse, &d);
+    bench_run("lob_direct", sizes[i], run_lob_direct, &d);
+    bench_run("frames_roundtrip", sizes[i], run_frames, &d);
+    bench_run("chunks_roundtrip", sizes[i], run_chunks, &d);
+    lob_free(d.packet);
+  }
+
+  // head access doesn't depend on the body
+  d.packet = bench_packet(0);
+  bench_run("lob_get", d.packet->head_len, run_lob_get, &d);
+  bench_run("lob_set", d.packet->head_len, run_lob_set, &d);
+  lob_free(d.packet);
+
+  // worst case, the wanted key is last
+  for(i = 0; i < SIZES; i++)
+  {
+    d.json = bench_json(sizes[i], d.key);
+    bench_run("js0n", sizes[i], run_js0n, &d);
+    free(d.json);
+  }
+
+  // xht sized to its prime with all keys present
+  static const uint32_t primes[] = {17, 211, 2003};
+  for(i = 0; i < sizeof(primes)/sizeof(primes[0]); i++)
+  {
+    d.count = primes[i];
+    d.keys = malloc(d.count * sizeof(d.keys[0]));
+    for(k = 0; k < d.count; k++) sprintf(d.keys[k], "key%u", k);
+    d.xht = xht_new(primes[i]);
+    bench_run("xht_set", d.count, run_xht_set, &d);
+    bench_run("xht_get", d.count, run_xht_get, &d);
+    xht_free(d.xht);
+    free(d.keys);
+  }
+
+  return bench_end();
+}
@@ -0,0 +1,201 @@
+#include <getopt.h>
+#include "bench.h"
+#include "net_loopback.h"
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// how lookups and processing cost grow with the number of links on one mesh
+//   -s comma separated link counts (default 10,1000, 10000 and up take minutes)
+//   -k key cache file (default bin/bench_links.keys), generating keys is slow so they're kept between runs
+// every count is measured with one real peer linked first, so its channel packets are the last link scanned
+
+typedef struct bench_links_struct
+{
+  mesh_t mesh;
+  link_t *links;
+  uint32_t count;
+  uint32_t next; // rotates through links for lookups
+  lob_t outer; // a channel packet from the peer
+  uint32_t now;
+} bench_links_s;
+
+// one json keys object per line, generated and appended to the cache as needed
+static lob_t *bench_keys(const char *file, uint32_t count)
+{
+  lob_t *keys = malloc(count * sizeof(lob_t));
+  char line[1024];
+  uint32_t have = 0;
+  size_t len;
+  FILE *fd;
+
+  if((fd = fopen(file, "r")))
+  {
+    while(have < count && fgets(line, sizeof(line), fd))
+    {
+      len = strlen(line);
+      while(len && (line[len-1] == '\n' || line[len-1] == '\r')) line[--len] = 0;
+      if(!len) continue;
+      keys[have] = lob_new();
+      lob_head(keys[have], (uint8_t*)line, len);
+      have++;
+    }
+    fclose(fd);
+  }
+  if(have == count) return keys;
+
+  fprintf(stderr, "generating %u keys into %s\n", count - have, file);
+  fd = fopen(file, "a");
+  for(; have < count; have++)
+  {
+    lob_t secrets = e3x_generate();
+    keys[have] = lob_copy(lob_linked(secrets));
+    lob_free(secrets);
+    if(fd) fprintf(fd, "%s\n", lob_json(keys[have]));
+  }
+  if(fd) fclose(fd);
+  return keys;
+}
+
+static size_t bench_heap(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+static void run_link_get(void *arg, uint64_t iters)
+{
+  bench_links_s *b = arg;
+  link_t link;
+  while(iters--)
+  {
+    link = b->links[b->next++ % b->count];
+    if(link_get(b->mesh, link->id) != link) LOG_ERROR("lookup failed");
+  }
+}
+
+static void run_mesh_linked(void *arg, uint64_t iters)
+{
+  bench_links_s *b = arg;
+  link_t link;
+  while(iters--)
+  {
+    link = b->links[b->next++ % b->count];
+    if(mesh_linked(b->mesh, hashname_char(link->id), 0) != link) LOG_ERROR("lookup failed");
+  }
+}
+
+static void run_mesh_receive(void *arg, uint64_t iters)
+{
+  bench_links_s *b = arg;
+  while(iters--) mesh_receive(b->mesh, lob_copy(b->outer));
+}
+
+static void run_mesh_process(void *arg, uint64_t iters)
+{
+  bench_links_s *b = arg;
+  while(iters--) mesh_process(b->mesh, b->now);
+}
+
+// the peer's packets land on a channel that just drops them
+static void bench_drain(chan_t c, void *arg)
+{
+  lob_t packet;
+  while((packet = chan_receiving(c))) lob_free(packet);
+}
+
+int main(int argc, char **argv)
+{
+  char *counts = "10,1000", *file = "bin/bench_links.keys", *at;
+  uint32_t scales[16], nscales = 0, max = 0, i, s;
+  bench_links_s b;
+  lob_t *keys;
+  size_t heap;
+  uint64_t start, took, allocs;
+  int opt;
+
+  while((opt = getopt(argc, argv, "s:k:")) != -1)
+  {
+    switch(opt)
+    {
+      case 's': counts = optarg; break;
+      case 'k': file = optarg; break;
+      default:
+        fprintf(stderr, "usage: %s [-s 10,1000,...] [-k keyfile]\n", argv[0]);
+        return 1;
+    }
+  }
+  for(at = counts; at && *at && nscales < 16; at = strchr(at, ','), at = at ? at + 1 : NULL)
+  {
+    if(!(scales[nscales] = (uint32_t)atoi(at))) continue;
+    if(scales[nscales] > max) max = scales[nscales];
+    nscales++;
+  }
+  if(!max) return 1;
+
+  e3x_init(NULL);
+  util_sys_logging(0);
+  keys = bench_keys(file, max);
+  bench_begin("links");
+
+  // the real peer is the oldest link, so the last one a scan of the list reaches
+  memset(&b, 0, sizeof(b));
+  b.mesh = mesh_new();
+  lob_free(mesh_generate(b.mesh));
+  mesh_t peer = mesh_new();
+  lob_free(mesh_generate(peer));
+  net_loopback_t pair = net_loopback_new(b.mesh, peer);
+  link_t linkAB = link_get(b.mesh, peer->id);
+  link_t linkBA = link_get(peer, b.mesh->id);
+  link_resync(linkAB);
+  lob_t open = lob_new();
+  lob_set(open, "type", "bench");
+  chan_t c = link_chan(linkAB, open);
+  chan_handle(c, bench_drain, NULL);
+  lob_t inner = lob_new();
+  lob_set_uint(inner, "c", chan_id(c));
+  lob_body(inner, NULL, 512);
+  b.outer = e3x_exchange_send(linkBA->x, inner);
+  lob_free(inner);
+  if(!link_up(linkAB) || !b.outer)
+  {
+    fprintf(stderr, "peer link failed\n");
+    return 1;
+  }
+
+  b.links = malloc(max * sizeof(link_t));
+  b.now = util_sys_seconds();
+  for(s = 0; s < nscales; s++)
+  {
+    if(scales[s] <= b.count) continue;
+
+    // grow to this size, the cost per added link and what it holds on to
+    heap = bench_heap();
+    allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+    start = util_sys_ns();
+    for(i = b.count; i < scales[s]; i++) b.links[i] = link_get_keys(b.mesh, keys[i]);
+    took = util_sys_ns() - start;
+    allocs = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED) - allocs;
+    bench_report("link_add", scales[s], 1, scales[s] - b.count, took, allocs);
+    printf(",\n  {\"name\":\"link_bytes\",\"size\":%u,\"bytes\":%.0f}", scales[s], (double)(bench_heap() - heap) / (scales[s] - b.count));
+    b.count = scales[s];
+
+    bench_run("link_get", b.count, run_link_get, &b);
+    bench_run("mesh_linked", b.count, run_mesh_linked, &b);
+    bench_run("mesh_receive", b.count, run_mesh_receive, &b);
+    bench_run("mesh_process", b.count, run_mesh_process, &b);
+  }
+
+  lob_free(b.outer);
+  mesh_free(b.mesh);
+  mesh_free(peer);
+  net_loopback_free(pair);
+  lob_free(open);
+  for(i = 0; i < max; i++) lob_free(keys[i]);
+  free(keys);
+  free(b.links);
+  return bench_end();
+}
@@ -41,6 +41,7 @@ extern "C" {
 
 // local wrapper
 void aes_128_ctr(unsigned char *key, size_t length, unsigned char nonce_counter[16], const unsigned char *input, unsigned char *output);
+void aes_128_ctr_multi(unsigned char *key, size_t count, const size_t length[], unsigned char *nonce_counter[], const unsigned char *const input[], unsigned char *output[]);
 
 /**
  * \brief          AES context structure
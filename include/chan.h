@@ -5,6 +5,38 @@
 
 enum chan_states { CHAN_ENDED, CHAN_OPENING, CHAN_OPEN };
 
+// reliable channels have at most this many packets sent and not yet acked, more wait their turn
+#ifndef CHAN_WINDOW
+#define CHAN_WINDOW 64
+#endif
+
+// ms bounds on the retransmit timeout, which otherwise follows the measured round trip
+#ifndef CHAN_RTO_MIN
+#define CHAN_RTO_MIN 100
+#endif
+#ifndef CHAN_RTO_MAX
+#define CHAN_RTO_MAX 4000
+#endif
+
+// most missing seqs listed in one ack
+#ifndef CHAN_MISS_MAX
+#define CHAN_MISS_MAX 32
+#endif
+
+// most received packets held until chan_receiving() takes them, past that a reliable channel stops acking (its
+// advertised window closes) and an unreliable one drops what arrives
+#ifndef CHAN_BUFFER
+#define CHAN_BUFFER 256
+#endif
+
+// a sent packet held until it's acked
+typedef struct chan_sent_struct
+{
+  lob_t packet;
+  uint32_t at; // ms it last went out
+  uint8_t tries;
+} chan_sent_s;
+
 // standalone channel packet management, buffering and ordering
 // internal only structure, always use accessors
 struct chan_struct
@@ -14,6 +46,7 @@ struct chan_struct
   uint32_t id; // wire id (not unique)
   char *type;
   lob_t in;
+  uint32_t in_len, buffer; // held for chan_receiving() and the most that will be
 
   // timer stuff
   uint32_t tsent, trecv; // last send, recv at
@@ -22,37 +55,73 @@ struct chan_struct
   // direct handler
   void *arg;
   void (*handle)(chan_t c, void *arg);
+  void (*writable)(chan_t c, void *arg);
+  uint8_t full; // chan_writable() got to 0, writable is called once it isn't
+
+  // reliability, each direction has its own seqs starting at 1 and slots are indexed by seq % window
+  uint32_t window; // 0 if unreliable
+  uint32_t seq; // next one to send
+  uint32_t last; // highest one that's gone out, acks can't be past it
+  uint32_t acked; // the other side has everything up to this
+  uint32_t ack, seen; // we have everything up to ack, and the highest at all
+  chan_sent_s *sent; // unacked
+  lob_t *early; // arrived ahead of a gap
+  lob_t out, out_end; // waiting for room in the window, at most a window of them
+  uint32_t win; // how many past acked the other side last said it has room for
+  uint32_t told; // the room we last said we have
+  uint32_t rtt, rttvar, rto; // ms
+  uint8_t acking; // got something since we last said what we have
 
   enum chan_states state;
 };
 
 // caller must manage lists of channels per e3x_exchange based on cid
-chan_t chan_new(lob_t open); // open must be chan_receive or chan_send next yet
+chan_t chan_new(lob_t open); // open must be chan_receive or chan_send next yet, one with a seq makes it reliable
 chan_t chan_free(chan_t c);
 
+// makes it reliable with this send window (0 for CHAN_WINDOW) before anything is sent, the open goes out with seq 1
+chan_t chan_reliable(chan_t c, uint32_t window);
+
+// how many received packets it holds before pushing back on the sender (0 leaves it), returns the current one
+uint32_t chan_buffer(chan_t c, uint32_t packets);
+
 // sets when in the future this channel should timeout auto-error from no receive, returns current timeout
 uint32_t chan_timeout(chan_t c, uint32_t at);
 
 // returns current inbox cache
 uint32_t chan_size(chan_t c);
 
+// packets waiting in chan_receiving()
+uint32_t chan_readable(chan_t c);
+
+// how many more chan_send() will take before it refuses (window full), unreliable ones always take another
+uint32_t chan_writable(chan_t c);
+
+// most body bytes a chan_packet() can carry and still go out whole in one packet on the link, 0 if no limit
+uint32_t chan_mtu(chan_t c);
+
 // incoming packets
 chan_t chan_receive(chan_t c, lob_t inner); // process into receiving queue
 chan_t chan_sync(chan_t c, uint8_t sync); // false to force start timeouts (after any new handshake), true to cancel and resend last packet (after any e3x_exchange_sync)
 lob_t chan_receiving(chan_t c); // get next avail packet in order, null if nothing
+chan_t chan_ack(chan_t c); // sends an ack/miss now, reliable only (chan_process does when one is owed)
 
 // outgoing packets
 lob_t chan_oob(chan_t c); // id/ack/miss only headers base packet
-lob_t chan_packet(chan_t c);  // creates a sequenced packet w/ all necessary headers, just a convenience
-chan_t chan_send(chan_t c, lob_t inner); // encrypts and sends packet out link
+lob_t chan_packet(chan_t c);  // creates a packet w/ all necessary headers, just a convenience (reliable ones get their seq as they're sent)
+chan_t chan_send(chan_t c, lob_t inner); // encrypts and sends packet out link, reliable ones may wait for the window and are dropped if it's full
+chan_t chan_send_batch(chan_t c, lob_t inners); // encrypts a list of packets together and sends them in order, NULL if any were dropped
 chan_t chan_err(chan_t c, char *err); // generates local-only error packet for next chan_process()
 
-// must be called after every send or receive, processes resends/timeouts, fires handlers
+// must be called after every send or receive (and often, resends are timed in mesh_ms()), processes resends/timeouts, fires handlers
 chan_t chan_process(chan_t c, uint32_t now);
 
-// set up internal handler for all incoming packets on this channel
+// set up internal handler for all incoming packets on this channel, called while any are readable
 chan_t chan_handle(chan_t c, void (*handle)(chan_t c, void *arg), void *arg);
 
+// called (with the chan_handle arg) when a full window opens up again
+chan_t chan_on_writable(chan_t c, void (*writable)(chan_t c, void *arg));
+
 // convenience functions, accessors
 chan_t chan_next(chan_t c); // c->next
 uint32_t chan_id(chan_t c); // c->id
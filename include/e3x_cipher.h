@@ -37,8 +37,11 @@ typedef struct e3x_cipher_struct
   void (*ephemeral_free)(ephemeral_t ephemeral);
   lob_t (*ephemeral_encrypt)(ephemeral_t ephemeral, lob_t inner);
   lob_t (*ephemeral_decrypt)(ephemeral_t ephemeral, lob_t outer);
+  lob_t (*ephemeral_encrypt_batch)(ephemeral_t ephemeral, lob_t inners); // optional, list of inners to list of outers in order
+  lob_t (*ephemeral_decrypt_batch)(ephemeral_t ephemeral, lob_t outers); // optional, list of outers to list of the inners that decrypted
 
   uint8_t id, csid;
+  uint16_t overhead; // bytes ephemeral_encrypt adds to the inner's lob_len, for sizing packets to a pipe
   char hex[3], *alg;
 } *e3x_cipher_t;
 
@@ -46,7 +46,9 @@ lob_t e3x_exchange_handshake(e3x_exchange_t x, lob_t inner);
 
 // simple synchronous encrypt/decrypt conversion of any packet for channels
 lob_t e3x_exchange_receive(e3x_exchange_t x, lob_t outer); // goes to channel, validates cid
+lob_t e3x_exchange_receive_batch(e3x_exchange_t x, lob_t outers); // list of inners for every outer that decrypted, in order
 lob_t e3x_exchange_send(e3x_exchange_t x, lob_t inner); // comes from channel 
+lob_t e3x_exchange_send_batch(e3x_exchange_t x, lob_t inners); // list of inners to list of outers in the same order, NULL if any fail
 
 // validate the next incoming channel id from the packet, or return the next avail outgoing channel id
 uint32_t e3x_exchange_cid(e3x_exchange_t x, lob_t incoming);
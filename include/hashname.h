@@ -8,21 +8,29 @@
 typedef struct hashname_struct
 {
   uint8_t bin[32];
+  char str[53]; // base32 of bin, encoded on first hashname_char()
+  char sstr[9]; // base32 of the short name, encoded on first hashname_short()
 } *hashname_t;
 
 // only things that actually malloc/free
 hashname_t hashname_dup(hashname_t hn);
 hashname_t hashname_free(hashname_t hn);
 
-// everything else returns a pointer to a static global for temporary use
+// everything else returns a pointer to a per-thread global for temporary use
 hashname_t hashname_vchar(const char *str); // from a string
 hashname_t hashname_vbin(const uint8_t *bin);
 hashname_t hashname_vkeys(lob_t keys);
 hashname_t hashname_vkey(lob_t key, uint8_t id); // key is body, intermediates in json
 
+// reentrant versions of the above that fill in and return the caller's hn (usually on the stack)
+hashname_t hashname_vchar_r(const char *str, hashname_t hn);
+hashname_t hashname_vbin_r(const uint8_t *bin, hashname_t hn);
+hashname_t hashname_vkeys_r(lob_t keys, hashname_t hn);
+hashname_t hashname_vkey_r(lob_t key, uint8_t id, hashname_t hn);
+
 // accessors
 uint8_t *hashname_bin(hashname_t hn); // 32 bytes
-char *hashname_char(hashname_t hn); // 52 byte base32 string w/ \0 (TEMPORARY)
+char *hashname_char(hashname_t hn); // 52 byte base32 string w/ \0, cached and valid as long as hn is
 
 // utilities related to hashnames
 int hashname_cmp(hashname_t a, hashname_t b);  // memcmp shortcut
@@ -30,10 +38,12 @@ uint8_t hashname_id(lob_t a, lob_t b); // best matching id (single byte)
 lob_t hashname_im(lob_t keys, uint8_t id); // intermediate hashes in the json, optional id to set that as body
 
 // working with short hashnames (5 bin bytes, 8 char bytes)
-char *hashname_short(hashname_t hn); // 8 byte base32 string w/ \0 (TEMPORARY)
+char *hashname_short(hashname_t hn); // 8 byte base32 string w/ \0, cached and valid as long as hn is
 int hashname_scmp(hashname_t a, hashname_t b);  // short only comparison
 hashname_t hashname_schar(const char *str); // 8 char string, temp hn
 hashname_t hashname_sbin(const uint8_t *bin); // 5 bytes, temp hn
+hashname_t hashname_schar_r(const char *str, hashname_t hn); // reentrant versions
+hashname_t hashname_sbin_r(const uint8_t *bin, hashname_t hn);
 hashname_t hashname_isshort(hashname_t hn); // NULL unless is short
 
 #endif
@@ -4,6 +4,34 @@
 
 #include "mesh.h"
 
+// most delivery pipes a link holds at once, adding another replaces the worst
+#ifndef LINK_PIPES
+#define LINK_PIPES 4
+#endif
+
+// ms a pipe may go without being heard from after a send before it's failed over from, and the least it's given
+// once its round trip is known
+#ifndef LINK_PIPE_TIMEOUT
+#define LINK_PIPE_TIMEOUT 2000
+#endif
+#ifndef LINK_PIPE_RTO_MIN
+#define LINK_PIPE_RTO_MIN 200
+#endif
+
+// one way of reaching the link and how well it's working, times are from mesh_ms()
+typedef struct link_pipe_struct
+{
+  link_t (*send)(link_t link, lob_t packet, void *arg);
+  void *arg;
+  uint32_t rtt; // smoothed round trip, 0 until there's a sample
+  uint32_t rttvar;
+  uint32_t mtu; // largest packet it carries, 0 unknown
+  uint32_t heard; // last time something arrived over it
+  uint32_t waiting; // oldest send since then, 0 if none
+  uint16_t loss; // smoothed share of sends that timed out, of 65535
+  uint8_t failed; // timed out or refused a send, skipped until heard from again
+} link_pipe_s;
+
 struct link_struct
 {
   // public link data
@@ -14,13 +42,15 @@ struct link_struct
   chan_t chans;
   uint32_t state; // peer's current state
 
-  // transport plumbing
-  void *send_arg;
-  link_t (*send_cb)(link_t link, lob_t packet, void *arg);
-  
+  // transport plumbing, sends go over the best of these
+  link_pipe_s pipes[LINK_PIPES];
+  uint8_t pipes_len;
+
   // these are for internal link management only
   link_t next;
   uint8_t csid;
+
+  struct mesh_stats_struct stats;
 };
 
 // these all create or return existing one from the mesh
@@ -35,18 +65,42 @@ lob_t link_key(link_t link);
 // get link info json
 lob_t link_json(link_t link);
 
+// snapshot of this link's traffic counters as json numbers, caller frees
+lob_t link_stats(link_t link);
+
 // removes from mesh
 void link_free(link_t link);
 
 // load in the key to existing link
 link_t link_load(link_t link, uint8_t csid, lob_t key);
 
-// add a delivery pipe to this link
+// add a delivery pipe to this link (sending it a handshake), transports call it again whenever anything arrives over
+// the pipe so it's known to be working
 link_t link_pipe(link_t link, link_t (*send)(link_t link, lob_t packet, void *arg), void *arg);
 
+// remove a pipe without notifying it, for transports going away
+link_t link_unpipe(link_t link, link_t (*send)(link_t link, lob_t packet, void *arg), void *arg);
+
+// the pipe sends currently go over, or a specific one, NULL if none
+link_pipe_s *link_pipe_best(link_t link);
+link_pipe_s *link_pipe_get(link_t link, link_t (*send)(link_t link, lob_t packet, void *arg), void *arg);
+
+// add a round trip sample in ms from anything that measured one (path pings etc)
+link_pipe_s *link_pipe_rtt(link_pipe_s *pipe, uint32_t ms);
+
+// transports set the largest packet a pipe carries whole once they know or have discovered it, 0 is no limit
+link_pipe_s *link_pipe_mtu(link_pipe_s *pipe, uint32_t mtu);
+
+// largest channel packet (lob_len of the inner) that fits in one packet over the best pipe once encrypted, 0 if
+// there's no limit
+uint32_t link_mtu(link_t link);
+
 // process a decrypted channel packet
 link_t link_receive(link_t link, lob_t inner);
 
+// process a list of decrypted channel packets, channels are only processed once at the end
+link_t link_receive_batch(link_t link, lob_t inners);
+
 // process an incoming handshake
 link_t link_receive_handshake(link_t link, lob_t handshake);
 
@@ -47,6 +47,9 @@ lob_t lob_parse(const uint8_t *raw, size_t len);
 // like lob_parse but takes over raw directly w/ no copy
 lob_t lob_direct(uint8_t *raw, size_t len);
 
+// like lob_direct but takes over the first len bytes of another lob's raw buffer, which is left empty
+lob_t lob_take(lob_t from, size_t len);
+
 // return full encoded packet
 uint8_t *lob_raw(lob_t p);
 size_t lob_len(lob_t p);
@@ -5,7 +5,23 @@ typedef struct mesh_struct *mesh_t;
 typedef struct link_struct *link_t;
 typedef struct chan_struct *chan_t;
 
+#include <stdint.h>
+
+// traffic counters kept on every mesh and link, mesh ones include everything its links count
+#define MESH_STATS(X) \
+  X(packets_in) X(bytes_in) X(packets_out) X(bytes_out) \
+  X(handshakes_ok) X(handshakes_bad) X(decrypt_fail) \
+  X(drop_short) X(drop_token) X(drop_route) X(drop_network) X(drop_delivery) X(drop_open) \
+  X(chan_open) X(chan_close) X(chan_resend)
+#define MESH_STATS_FIELD(name) uint64_t name;
+struct mesh_stats_struct
+{
+  MESH_STATS(MESH_STATS_FIELD)
+};
 
+// relaxed atomics so transports can count from their own threads
+#define MESH_STAT(x, name, n) __atomic_fetch_add(&(x)->stats.name, (uint64_t)(n), __ATOMIC_RELAXED)
+#define LINK_STAT(link, name, n) do{ MESH_STAT(link, name, n); MESH_STAT((link)->mesh, name, n); }while(0)
 
 #include "e3x.h"
 #include "lib.h"
@@ -21,6 +37,9 @@ struct mesh_struct
   void *on; // internal list of triggers
   uint32_t state; // our current state (from app)
   link_t links;
+  struct mesh_stats_struct stats;
+  uint64_t (*clock)(void *arg); // ms, NULL for the system's
+  void *clock_arg;
 };
 
 mesh_t mesh_new(void);
@@ -42,6 +61,18 @@ lob_t mesh_json(mesh_t mesh);
 // generate json for all links, returns lob list
 lob_t mesh_links(mesh_t mesh);
 
+// where it and its links and channels get the time from in ms, NULL goes back to the system clock (a simulator
+// supplies its virtual one), handshakes are stamped with it in seconds
+mesh_t mesh_clock(mesh_t mesh, uint64_t (*clock)(void *arg), void *arg);
+uint64_t mesh_ms(mesh_t mesh); // never 0, so that can mean unset
+uint32_t mesh_seconds(mesh_t mesh); // util_sys_seconds() unless there's a clock
+
+// snapshot of the traffic counters as json numbers, caller frees
+lob_t mesh_stats(mesh_t mesh);
+
+// the json for any set of counters, shared by mesh_stats() and link_stats()
+lob_t mesh_stats_json(struct mesh_stats_struct *stats);
+
 // creates a link from the json format of {"hashname":"...","keys":{},"paths":[]}
 link_t mesh_add(mesh_t mesh, lob_t json);
 
@@ -55,6 +86,9 @@ mesh_t mesh_unlink(link_t link);
 // processes incoming packet, it will take ownership of packet, returns link delivered to if success
 link_t mesh_receive(mesh_t mesh, lob_t packet);
 
+// processes an array of incoming packets (takes ownership of all), channel packets for the same link are decrypted together, returns last link delivered to
+link_t mesh_receive_batch(mesh_t mesh, lob_t *packets, size_t count);
+
 // process any unencrypted handshake packet
 link_t mesh_receive_handshake(mesh_t mesh, lob_t handshake);
 
@@ -3,13 +3,29 @@
 
 #include "mesh.h"
 
+// most packets a queued pair hands to mesh_receive_batch() at once
+#ifndef NET_LOOPBACK_BATCH
+#define NET_LOOPBACK_BATCH 32
+#endif
+
 typedef struct net_loopback_struct
 {
   mesh_t a, b;
+  link_t ab, ba; // piped over it, until they let go
+  uint8_t queued;
+  lob_t to_a, to_b; // queued packets oldest first, only when queued
+  lob_t to_a_end, to_b_end;
+  uint32_t to_a_len, to_b_len;
 } *net_loopback_t;
 
-// connect two mesh instances with each other for packet delivery
+// connect two mesh instances with each other for packet delivery, sending calls mesh_receive() on the other
 net_loopback_t net_loopback_new(mesh_t a, mesh_t b);
-void net_loopback_free(net_loopback_t pair);
+void net_loopback_free(net_loopback_t pair); // drops anything still queued and takes the pipe off both links
+
+// the same but sending only queues the packet, nothing arrives until net_loopback_process()
+net_loopback_t net_loopback_queued(mesh_t a, mesh_t b);
+
+// delivers up to batch queued packets each way (0 keeps going until nothing is left, including replies), returns how many
+uint32_t net_loopback_process(net_loopback_t pair, uint32_t batch);
 
 #endif
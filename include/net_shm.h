@@ -0,0 +1,43 @@
+#ifndef net_shm_h
+#define net_shm_h
+
+#if !defined(_WIN32) && (defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__)))
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mesh.h"
+
+// two processes on the same host sharing a mapped region with a single-producer/single-consumer ring each way,
+// packets are copied straight into the ring in lob framing and the only syscall is a futex wake when the other
+// side is asleep in net_shm_wait() (linux, elsewhere waiting polls)
+
+// default bytes in each ring, rounded up to a power of two
+#ifndef NET_SHM_SIZE
+#define NET_SHM_SIZE (1024*1024)
+#endif
+
+// how many whole packets to hand the mesh at once
+#ifndef NET_SHM_BATCH
+#define NET_SHM_BATCH 16
+#endif
+
+typedef struct net_shm_struct *net_shm_t;
+
+// options are {"name":"/shared-name","size":bytes}, the first process to use a name creates the region and the
+// second attaches to it, a name pairs exactly two
+net_shm_t net_shm_new(mesh_t mesh, lob_t options);
+net_shm_t net_shm_free(net_shm_t net); // the creator also unlinks the name
+
+// send this link's packets to the other side, links the mesh accepts from the other side are piped automatically
+link_t net_shm_link(net_shm_t net, link_t link);
+
+// delivers any waiting packets into the mesh
+net_shm_t net_shm_process(net_shm_t net);
+
+// sleeps up to ms for something to arrive, returns net if there's anything to process
+net_shm_t net_shm_wait(net_shm_t net, uint32_t ms);
+
+#endif // POSIX
+
+#endif // net_shm_h
@@ -0,0 +1,48 @@
+#ifndef net_sim_h
+#define net_sim_h
+
+#include "mesh.h"
+
+// in-process network of any number of meshes on a virtual clock, packets are queued as events and
+// delivered in (time, send order) so the same seed and sequence of calls always plays out the same way, the meshes
+// it links run on its clock (see mesh_clock()) until it's freed, a mesh is only on one sim at a time and can be freed
+// before it (whatever is queued to or from it is dropped)
+
+// one direction of a simulated path, times in virtual microseconds and chances in parts per million
+typedef struct net_sim_path_struct
+{
+  uint32_t latency; // one way delay
+  uint32_t jitter; // up to this much added at random
+  uint32_t loss; // chance a packet is dropped
+  uint32_t reorder; // chance a packet is held back another latency so later ones pass it
+  uint32_t bandwidth; // bytes per second, packets queue behind each other, 0 is unlimited
+} net_sim_path_s;
+
+typedef struct net_sim_struct *net_sim_t;
+
+net_sim_t net_sim_new(uint64_t seed);
+void net_sim_free(net_sim_t sim); // drops anything still queued and takes its pipes off the links
+
+// links a and b and pipes them through the simulator, path applies both ways (NULL is instant)
+net_sim_t net_sim_link(net_sim_t sim, mesh_t a, mesh_t b, net_sim_path_s *path);
+
+// changes the path both ways between two meshes it linked, for what's sent from now on
+net_sim_t net_sim_path(net_sim_t sim, mesh_t a, mesh_t b, net_sim_path_s *path);
+
+// current virtual time in microseconds, starts at 0
+uint64_t net_sim_now(net_sim_t sim);
+
+// delivers the next queued packet and moves the clock to it, 0 if nothing was queued
+uint32_t net_sim_step(net_sim_t sim);
+
+// delivers everything due up to and including this time, including whatever that sends, then sets the
+// clock to it, every linked mesh gets mesh_process() as each virtual second passes, returns packets delivered
+uint32_t net_sim_run(net_sim_t sim, uint64_t until);
+
+// packets waiting in the queue
+uint32_t net_sim_pending(net_sim_t sim);
+
+// totals since net_sim_new(), any may be NULL
+void net_sim_stats(net_sim_t sim, uint64_t *sent, uint64_t *delivered, uint64_t *dropped);
+
+#endif
@@ -10,6 +10,24 @@
 
 #include "mesh.h"
 
+// packets go out in util_frames (a header datagram and then the packet) as they always have until the peer answers a
+// small probe, after that each goes whole in one datagram and the pipe, starting at NET_UDP4_MTU_MIN, probes with
+// padded packets (sent with don't-fragment) to find the largest that gets through, which is then the link's pipe mtu,
+// an answer only counts if it echoes the random nonce that was in the probe, and both kinds are always received
+
+// udp payload bytes any ipv4 path carries unfragmented, and the most a datagram can hold
+#ifndef NET_UDP4_MTU_MIN
+#define NET_UDP4_MTU_MIN 1200
+#endif
+#ifndef NET_UDP4_MTU_MAX
+#define NET_UDP4_MTU_MAX 65507
+#endif
+
+// ms a probe gets to be answered before it's tried again, twice unanswered and that size is too big
+#ifndef NET_UDP4_PROBE_MS
+#define NET_UDP4_PROBE_MS 500
+#endif
+
 // overall server
 typedef struct net_udp4_struct *net_udp4_t;
 
@@ -17,13 +35,16 @@ typedef struct net_udp4_struct *net_udp4_t;
 net_udp4_t net_udp4_new(mesh_t mesh, lob_t options);
 net_udp4_t net_udp4_free(net_udp4_t net);
 
-// send/receive any waiting frames, delivers packets into mesh
+// receive any waiting packets into the mesh and send any mtu probes due
 net_udp4_t net_udp4_process(net_udp4_t net);
 
 // return server socket handle / port
 int net_udp4_socket(net_udp4_t net);
 uint16_t net_udp4_port(net_udp4_t net);
 
+// largest payload known to reach this address whole, NET_UDP4_MTU_MIN until probing finds more
+uint32_t net_udp4_mtu(net_udp4_t net, char *ip, uint16_t port);
+
 // send a packet directly
 net_udp4_t net_udp4_direct(net_udp4_t net, lob_t packet, char *ip, uint16_t port);
 
@@ -0,0 +1,54 @@
+#ifndef net_unix_h
+#define net_unix_h
+
+#if !defined(_WIN32) && (defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__)))
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mesh.h"
+
+// whole packets as AF_UNIX datagrams between processes on the same host, on linux they're moved in batches with
+// recvmmsg/sendmmsg and big ones are handed over as a memfd instead of being copied through the socket
+
+// how many datagrams go through one recvmmsg/sendmmsg
+#ifndef NET_UNIX_BATCH
+#define NET_UNIX_BATCH 16
+#endif
+
+// largest packet sent inline, bigger ones need a memfd
+#ifndef NET_UNIX_MTU
+#define NET_UNIX_MTU 65536
+#endif
+
+// most packets waiting to go to one socket, more are dropped until it reads some
+#ifndef NET_UNIX_QUEUE
+#define NET_UNIX_QUEUE 256
+#endif
+
+// overall server
+typedef struct net_unix_struct *net_unix_t;
+
+// create a new socket bound to {"path":"/run/app.sock"}, any stale socket file there is replaced, "memfd" is the
+// size a packet has to be to go by memfd instead (default and most NET_UNIX_MTU, 0 never)
+net_unix_t net_unix_new(mesh_t mesh, lob_t options);
+net_unix_t net_unix_free(net_unix_t net); // also removes the socket file
+
+// receive/send anything waiting, delivers packets into mesh
+net_unix_t net_unix_process(net_unix_t net);
+
+// return the (non-blocking) socket handle and the path it's bound to
+int net_unix_socket(net_unix_t net);
+char *net_unix_path(net_unix_t net);
+
+// send this link's packets to the socket at path
+link_t net_unix_link(net_unix_t net, link_t link, char *path);
+
+// send a packet directly
+net_unix_t net_unix_direct(net_unix_t net, lob_t packet, char *path);
+
+#endif // POSIX
+
+#endif // net_unix_h
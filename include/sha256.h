@@ -47,6 +47,16 @@ void SHA256_Final(unsigned char digest[32], SHA256_CTX * ctx);
 void SHA256_Update(SHA256_CTX * ctx, const void *in, size_t len);
 void SHA256_Init(SHA256_CTX * ctx);
 
+// hash several independent messages at once, out[i] must be [32] each, uses multi-buffer SIMD when available
+void sha256_multi(const uint8_t *const in[], const size_t ilen[], uint8_t *out[], size_t n);
+void hmac_256_multi(const unsigned char *const key[], const size_t keylen[],
+                  const unsigned char *const in[], const size_t ilen[],
+                  unsigned char *out[], size_t n);
+
+// compress back-end is picked at runtime on first use (safe from any thread), NULL returns the active one or name one to
+// force it ("generic", "shani", "armv8", "avx2"), forcing is safe while other threads hash
+char *sha256_backend(char *name);
+
 int hkdf_sha256( uint8_t *salt, uint32_t salt_len, uint8_t *ikm, uint32_t ikm_len, uint8_t *info, uint32_t info_len, uint8_t *okm, uint32_t okm_len);
 
 #ifdef __cplusplus
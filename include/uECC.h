@@ -30,9 +30,14 @@ platform. */
 
 /* uECC_SQUARE_FUNC - If enabled (defined as nonzero), this will cause a specific function to be
 used for (scalar) squaring instead of the generic multiplication function. This can make things
-faster somewhat faster, but increases the code size. */
+faster somewhat faster, but increases the code size. On by default for x86-64, where the
+assembly square saves six of the sixteen multiplies. */
 #ifndef uECC_SQUARE_FUNC
-    #define uECC_SQUARE_FUNC 0
+    #if defined(__amd64__) || defined(_M_X64)
+        #define uECC_SQUARE_FUNC 1
+    #else
+        #define uECC_SQUARE_FUNC 0
+    #endif
 #endif
 
 /* uECC_VLI_NATIVE_LITTLE_ENDIAN - If enabled (defined as nonzero), this will switch to native
@@ -10,8 +10,10 @@
 #include "util_chunks.h"
 #include "util_frames.h"
 #include "util_unix.h"
+#include "util_log.h"
+#include "util_trace.h"
 
-// make sure out is 2*len + 1
+// make sure out is 2*len + 1, NULL out returns a per-thread buffer that's reused on the next call
 char *util_hex(uint8_t *in, size_t len, char *out);
 // out must be len/2
 uint8_t *util_unhex(char *in, size_t len, uint8_t *out);
@@ -0,0 +1,34 @@
+#ifndef util_log_h
+#define util_log_h
+
+#if !defined(_WIN32) && (defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__)))
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+// optional asynchronous back-end for LOG(), callers only format the message into a lock-free ring and a
+// background thread does the writing, when it isn't running util_sys_log() writes synchronously as always
+
+// starts the writer, slots is rounded up to a power of two, text gets the usual lines and bin the compact
+// records (either may be NULL), !0 on failure or if already running
+int util_log_start(uint32_t slots, FILE *text, FILE *bin);
+
+// writes everything still queued and stops the writer
+void util_log_stop(void);
+
+// records per second allowed from any one LOG call site before repeats are suppressed (default 20, 0 is no limit)
+void util_log_burst(uint32_t per_second);
+
+// counters since the last start, any may be NULL
+void util_log_stats(uint64_t *written, uint64_t *dropped, uint64_t *suppressed);
+
+// turns a file of binary records back into text lines prefixed with their time, returns how many
+uint32_t util_log_decode(FILE *bin, FILE *text);
+
+// used by util_sys_log(), 0 if the ring isn't running and the caller should write it directly
+int util_log_vpush(uint8_t level, const char *file, int line, const char *function, const char *format, va_list args);
+
+#endif
+
+#endif
@@ -3,12 +3,22 @@
 
 typedef uint32_t at_t;
 
+// per-thread storage for the few temporaries handed back by the utility-mode calls
+#if defined(__GNUC__) || defined(__clang__)
+#define UTIL_TLS __thread
+#else
+#define UTIL_TLS
+#endif
+
 // returns a number that increments in seconds for comparison (epoch or just since boot)
 at_t util_sys_seconds();
 
 // number of milliseconds since given epoch seconds value
 unsigned long long util_sys_ms(long epoch);
 
+// monotonic nanoseconds from an arbitrary start, only for measuring intervals
+uint64_t util_sys_ns(void);
+
 unsigned short util_sys_short(unsigned short x);
 unsigned long util_sys_long(unsigned long x);
 
@@ -16,14 +26,28 @@ unsigned long util_sys_long(unsigned long x);
 void util_sys_random_init(void);
 long util_sys_random(void);
 
+// fill with seed-quality bytes from the OS, 0 on success
+int util_sys_entropy(uint8_t *bytes, size_t len);
+
 // -1 toggles debug, 0 disable, 1 enable
 void util_sys_logging(int enabled);
 
+// syslog levels https://en.wikipedia.org/wiki/Syslog#Severity_level plus 8 for CRAZY, -1 is silent
+void util_sys_log_level(int8_t level); // default for every module, all of them in DEBUG builds
+int util_sys_log_module(const char *module, int8_t level); // override for one source file's basename like "mesh" or "cs1c", !0 if full
+
+// highest level anything will print, checked before a LOG's arguments are evaluated
+extern int8_t util_sys_log_max;
+int util_sys_log_on(uint8_t level, const char *file);
+
+// fixed width name for a level, "WARN   " etc
+const char *util_sys_log_name(uint8_t level);
+
 // returns NULL for convenient return logging
 void *util_sys_log(uint8_t level, const char *file, int line, const char *function, const char * format, ...);
 
-// use syslog levels https://en.wikipedia.org/wiki/Syslog#Severity_level
-#define LOG_LEVEL(level, fmt, ...) util_sys_log(level, __FILE__, __LINE__, __func__, fmt, ## __VA_ARGS__)
+// arguments (lob_json, hashname_short, etc) are only evaluated when the level is enabled for the module
+#define LOG_LEVEL(level, fmt, ...) (((int8_t)(level) <= util_sys_log_max && util_sys_log_on(level, __FILE__)) ? util_sys_log(level, __FILE__, __LINE__, __func__, fmt, ## __VA_ARGS__) : NULL)
 
 // default LOG is DEBUG level and compile-time optional
 #ifndef LOG_DEBUG
@@ -35,15 +59,15 @@ void *util_sys_log(uint8_t level, const char *file, int line, const char *functi
 #define LOG_ERROR LOG
 #define LOG_CRAZY LOG
 #else
-#define LOG(fmt, ...) util_sys_log(7, __FILE__, __LINE__, __func__, fmt, ## __VA_ARGS__)
+#define LOG(fmt, ...) LOG_LEVEL(7, fmt, ## __VA_ARGS__)
 #define LOG_DEBUG LOG
-#define LOG_INFO(fmt, ...) util_sys_log(6, __FILE__, __LINE__, __func__, fmt, ## __VA_ARGS__)
-#define LOG_WARN(fmt, ...) util_sys_log(4, __FILE__, __LINE__, __func__, fmt, ## __VA_ARGS__)
-#define LOG_ERROR(fmt, ...) util_sys_log(3, __FILE__, __LINE__, __func__, fmt, ## __VA_ARGS__)
-#define LOG_CRAZY(fmt, ...) util_sys_log(8, __FILE__, __LINE__, __func__, fmt, ## __VA_ARGS__)
+#define LOG_INFO(fmt, ...) LOG_LEVEL(6, fmt, ## __VA_ARGS__)
+#define LOG_WARN(fmt, ...) LOG_LEVEL(4, fmt, ## __VA_ARGS__)
+#define LOG_ERROR(fmt, ...) LOG_LEVEL(3, fmt, ## __VA_ARGS__)
+#define LOG_CRAZY(fmt, ...) LOG_LEVEL(8, fmt, ## __VA_ARGS__)
 #endif
 #else
-#define LOG(fmt, ...) util_sys_log(7, __FILE__, __LINE__, __func__, fmt, ## __VA_ARGS__)
+#define LOG(fmt, ...) LOG_LEVEL(7, fmt, ## __VA_ARGS__)
 #endif
 
 // most things just need these
@@ -0,0 +1,50 @@
+#ifndef util_trace_h
+#define util_trace_h
+
+#include <stdint.h>
+#include "lob.h"
+
+// stages along the receive and send path, each inclusive of whatever it calls
+#define UTIL_TRACE_STAGES(X) \
+  X(mesh_receive) X(exchange_receive) X(lob_parse) X(link_receive) \
+  X(chan_handler) X(link_send) X(transport)
+
+#define UTIL_TRACE_ENUM(name) UTIL_TRACE_##name,
+typedef enum {
+  UTIL_TRACE_STAGES(UTIL_TRACE_ENUM)
+  UTIL_TRACE_MAX
+} util_trace_stage_t;
+#undef UTIL_TRACE_ENUM
+
+// build with -DUTIL_TRACE to time the stages, otherwise these compile to nothing
+#ifdef UTIL_TRACE
+#define TRACE_START(at) uint64_t at = util_sys_ns()
+#define TRACE_STOP(stage, at, ctx) util_trace_record(UTIL_TRACE_##stage, at, util_sys_ns() - (at), ctx)
+#define TRACE_STOP_EACH(stage, at, ctx, count) util_trace_record_each(UTIL_TRACE_##stage, at, util_sys_ns() - (at), ctx, count)
+#else
+#define TRACE_START(at)
+#define TRACE_STOP(stage, at, ctx) do{}while(0)
+#define TRACE_STOP_EACH(stage, at, ctx, count) do{}while(0)
+#endif
+
+// called after every timed stage with its start and duration in ns, ctx is the mesh/link/lob/chan it ran on
+typedef void (*util_trace_f)(util_trace_stage_t stage, uint64_t start, uint64_t ns, void *ctx, void *arg);
+void util_trace_hook(util_trace_f hook, void *arg); // NULL hook removes it
+
+// adds one sample to a stage's histogram and fires the hook
+void util_trace_record(util_trace_stage_t stage, uint64_t start, uint64_t ns, void *ctx);
+
+// a stage run once over a batch of packets, records a sample per packet with its even share of the time
+void util_trace_record_each(util_trace_stage_t stage, uint64_t start, uint64_t ns, void *ctx, uint32_t count);
+
+// name of a stage as used in the snapshot, NULL if out of range
+const char *util_trace_name(util_trace_stage_t stage);
+
+// json of every stage with samples, {"mesh_receive":{"count":..,"min":..,"max":..,"mean":..,"p50":..,"p90":..,"p99":..,"p999":..},...}
+// all in ns and percentiles within ~6%, caller frees
+lob_t util_trace_snapshot(void);
+
+// zero all the histograms
+void util_trace_reset(void);
+
+#endif
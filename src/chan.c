@@ -22,11 +22,34 @@ chan_t chan_new(lob_t open)
   c->state = CHAN_OPENING;
   c->id = id;
   c->type = lob_get(open,"type");
+  c->seq = 1;
+  c->buffer = CHAN_BUFFER;
+
+  // the opener sequenced it
+  if(lob_get(open,"seq") && !chan_reliable(c, 0)) return chan_free(c);
 
   LOG("new channel %d %s",id,type);
   return c;
 }
 
+chan_t chan_reliable(chan_t c, uint32_t window)
+{
+  if(!c) return LOG("bad args");
+  if(c->window) return c;
+  if(!window) window = CHAN_WINDOW;
+
+  if(!(c->sent = calloc(window, sizeof(chan_sent_s))) || !(c->early = calloc(window, sizeof(lob_t))))
+  {
+    free(c->sent);
+    c->sent = NULL;
+    return LOG("OOM");
+  }
+  c->window = c->win = window;
+  c->rto = 1000; // until there's a round trip, like tcp
+
+  return c;
+}
+
 chan_t chan_free(chan_t c)
 {
   if(!c) return NULL;
@@ -39,6 +62,15 @@ chan_t chan_free(chan_t c)
   }
 
   // free any other queued packets
+  uint32_t i;
+  for(i = 0; i < c->window; i++)
+  {
+    lob_free(c->sent[i].packet);
+    lob_free(c->early[i]);
+  }
+  free(c->sent);
+  free(c->early);
+  lob_freeall(c->out);
   lob_freeall(c->in);
   free(c);
   return NULL;
@@ -75,22 +107,223 @@ enum chan_states chan_state(chan_t c)
   return c->state;
 }
 
+// ms clock for resends from the link's mesh (a simulator drives it there), never 0
+static uint32_t chan_ms(chan_t c)
+{
+  uint32_t ms = (uint32_t)mesh_ms(c->link ? c->link->mesh : NULL);
+  return ms ? ms : 1;
+}
+
+// follows the round trip again, dropping any backoff
+static void chan_rto(chan_t c)
+{
+  if(!c->rtt) return;
+  c->rto = c->rtt + 4 * c->rttvar;
+  if(c->rto < CHAN_RTO_MIN) c->rto = CHAN_RTO_MIN;
+  if(c->rto > CHAN_RTO_MAX) c->rto = CHAN_RTO_MAX;
+}
+
+// smoothed like tcp does, the timeout follows it
+static void chan_rtt(chan_t c, uint32_t ms)
+{
+  uint32_t diff;
+  if(!c->rtt)
+  {
+    c->rtt = ms ? ms : 1;
+    c->rttvar = ms / 2;
+  }else{
+    diff = (c->rtt > ms) ? c->rtt - ms : ms - c->rtt;
+    c->rttvar = (3 * c->rttvar + diff) / 4;
+    c->rtt = (7 * c->rtt + ms) / 8;
+    if(!c->rtt) c->rtt = 1;
+  }
+  chan_rto(c);
+}
+
+// room left for what's received, what goes out in acks
+static uint32_t chan_room(chan_t c)
+{
+  uint32_t room = (c->buffer > c->in_len) ? c->buffer - c->in_len : 0;
+  return (room < c->window) ? room : c->window;
+}
+
+// how far past acked it can send, one always goes out to find out when a closed window opens
+static uint32_t chan_limit(chan_t c)
+{
+  uint32_t limit = (c->win < c->window) ? c->win : c->window;
+  return limit ? limit : 1;
+}
+
+// encrypts and sends, the inner stays the caller's
+static chan_t chan_out(chan_t c, lob_t inner)
+{
+  lob_t outer;
+  if(!c->link) return LOG("dropping packet, no link");
+  if(!(outer = e3x_exchange_send(c->link->x, inner))) return NULL;
+  return link_send(c->link, outer) ? c : NULL;
+}
+
+// sends it again or for the first time from its slot, with our latest ack on it
+static void chan_transmit(chan_t c, lob_t inner, uint32_t now)
+{
+  uint32_t seq = lob_get_uint(inner,"seq");
+  chan_sent_s *sent = &c->sent[seq % c->window];
+
+  if(seq > c->last) c->last = seq;
+  lob_set_uint(inner,"ack",c->ack);
+  lob_set_uint(inner,"win",c->told = chan_room(c));
+  if(c->seen == c->ack) c->acking = 0; // nothing missing, so that says it all
+
+  if(sent->packet != inner)
+  {
+    lob_free(sent->packet);
+    sent->packet = inner;
+    sent->tries = 0;
+  }
+  if(sent->tries++ && c->link) LINK_STAT(c->link, chan_resend, 1);
+  sent->at = now;
+
+  chan_out(c, inner); // an ack may come back through and free it before this returns
+}
+
+// send what's waiting as the window opens up
+static void chan_flush(chan_t c)
+{
+  lob_t inner;
+  uint32_t now = chan_ms(c);
+  while((inner = c->out) && lob_get_uint(inner,"seq") - c->acked <= chan_limit(c))
+  {
+    c->out = inner->next;
+    if(!c->out) c->out_end = NULL;
+    inner->next = NULL;
+    chan_transmit(c, inner, now);
+  }
+}
+
+// what the other side has, frees everything it acks and resends what it says is missing
+static void chan_acked(chan_t c, lob_t inner)
+{
+  uint32_t ack, seq, now, i;
+  chan_sent_s *sent;
+  char *miss, *val;
+  size_t len, vlen;
+
+  if(!lob_get(inner,"ack")) return;
+  ack = lob_get_uint(inner,"ack");
+  if(ack > c->last)
+  {
+    LOG_WARN("ignoring ack %u past what's been sent %u",ack,c->last);
+    return;
+  }
+
+  now = chan_ms(c);
+  if(lob_get(inner,"win") && ack >= c->acked) c->win = lob_get_uint(inner,"win");
+  if(ack > c->acked)
+  {
+    // only one that went out once can time the round trip
+    sent = &c->sent[ack % c->window];
+    if(sent->packet && sent->tries == 1) chan_rtt(c, now - sent->at);
+    else chan_rto(c); // it's getting through
+    for(seq = c->acked + 1; seq <= ack; seq++) c->sent[seq % c->window].packet = lob_free(c->sent[seq % c->window].packet);
+    c->acked = ack;
+  }
+
+  // misses are offsets from the ack, resent right away the first time (something after it got there) and after that
+  // only once a resend has had a round trip to get there
+  if((miss = lob_get_raw(inner,"miss")) && (len = lob_get_len(inner,"miss")) && *miss == '[')
+  {
+    for(i = 0; (val = js0n(NULL,i,miss,len,&vlen)); i++)
+    {
+      seq = ack + (uint32_t)strtoul(val,NULL,10);
+      if(seq <= c->acked || seq - c->acked > c->window) continue;
+      sent = &c->sent[seq % c->window];
+      if(!sent->packet || (sent->tries > 1 && now - sent->at < (c->rtt ? c->rtt : c->rto))) continue;
+      chan_transmit(c, sent->packet, now);
+    }
+  }
+
+  chan_flush(c);
+}
+
 // incoming packets
 
+// everything up to the next gap is in order now, as far as there's room for it, returns how many
+static uint32_t chan_drain(chan_t c)
+{
+  uint32_t count = 0;
+  lob_t inner;
+  while(c->in_len < c->buffer && (inner = c->early[(c->ack + 1) % c->window]))
+  {
+    c->early[(c->ack + 1) % c->window] = NULL;
+    c->ack++;
+    c->in = lob_push(c->in, inner);
+    c->in_len++;
+    count++;
+  }
+  return count;
+}
+
 // process into receiving queue
 chan_t chan_receive(chan_t c, lob_t inner)
 {
+  uint32_t seq;
   if(!c || !inner) return LOG("bad args");
-  
-  c->in = lob_push(c->in, inner);
+
+  if(!c->window)
+  {
+    if(c->in_len >= c->buffer)
+    {
+      lob_free(inner);
+      return LOG_WARN("dropping packet, %u waiting on channel %u",c->in_len,c->id);
+    }
+    c->in = lob_push(c->in, inner);
+    c->in_len++;
+    return c;
+  }
+
+  chan_acked(c, inner);
+
+  // bare acks are used up
+  if(!(seq = lob_get_uint(inner,"seq")))
+  {
+    if(lob_get(inner,"ack")) lob_free(inner);
+    else{
+      c->in = lob_push(c->in, inner);
+      c->in_len++;
+    }
+    return c;
+  }
+
+  c->acking = 1;
+  if(seq <= c->ack || seq - c->ack > c->window || c->early[seq % c->window])
+  {
+    LOG_DEBUG("dropping seq %u, have %u of %u",seq,c->ack,c->seen);
+    lob_free(inner);
+    return c;
+  }
+  if(seq > c->seen) c->seen = seq;
+  c->early[seq % c->window] = inner;
+  chan_drain(c);
+
   return c;
 }
 
 // false to force start timers (any new handshake), true to cancel and resend last packet (after any e3x_sync)
 chan_t chan_sync(chan_t c, uint8_t sync)
 {
+  uint32_t seq, now;
+  chan_sent_s *sent;
   if(!c) return NULL;
-  LOG("%d sync %d TODO",c->id,sync);
+  if(!c->window) return c;
+
+  now = chan_ms(c);
+  for(seq = c->acked + 1; seq < c->seq; seq++)
+  {
+    sent = &c->sent[seq % c->window];
+    if(!sent->packet) continue;
+    if(sync) chan_transmit(c, sent->packet, now);
+    else sent->at = now;
+  }
   return c;
 }
 
@@ -103,22 +336,55 @@ lob_t chan_receiving(chan_t c)
   ret = lob_shift(c->in);
   c->in = ret->next;
   ret->next = NULL;
+  c->in_len--;
+
+  // say so when held back ones got acked or the window we gave has opened up a lot
+  if(c->window && (chan_drain(c) || (c->told < c->window / 2 && chan_room(c) > c->told))) c->acking = 1;
 
   if(lob_get(ret,"end")) c->state = CHAN_ENDED;
 
   return ret;
 }
 
+// sends what we have and what's missing
+chan_t chan_ack(chan_t c)
+{
+  lob_t ack;
+  if(!c || !c->window) return NULL;
+  if(!(ack = chan_oob(c))) return NULL;
+  c->acking = 0;
+  if(!chan_out(c, ack)) c = NULL;
+  lob_free(ack);
+  return c;
+}
+
 // outgoing packets
 
 // ack/miss only base packet
 lob_t chan_oob(chan_t c)
 {
+  char miss[CHAN_MISS_MAX * 11 + 2];
+  uint32_t seq, count = 0;
+  int len = 0;
   if(!c) return NULL;
 
   lob_t ret = lob_new();
   lob_set_uint(ret,"c",c->id);
-  
+  if(!c->window) return ret;
+
+  lob_set_uint(ret,"ack",c->ack);
+  lob_set_uint(ret,"win",c->told = chan_room(c));
+  for(seq = c->ack + 1; seq < c->seen && count < CHAN_MISS_MAX; seq++)
+  {
+    if(c->early[seq % c->window]) continue;
+    len += snprintf(miss + len, sizeof(miss) - len, "%c%u", count++ ? ',' : '[', seq - c->ack);
+  }
+  if(count)
+  {
+    miss[len++] = ']';
+    lob_set_raw(ret,"miss",4,miss,(size_t)len);
+  }
+
   return ret;
 }
 
@@ -127,12 +393,27 @@ lob_t chan_packet(chan_t c)
 {
   lob_t ret;
   if(!c) return NULL;
-  
-  ret = chan_oob(c);
+
+  ret = lob_new();
+  lob_set_uint(ret,"c",c->id);
 
   return ret;
 }
 
+// reliable ones get the next seq and are held until acked, and wait if the window is full
+static chan_t chan_sequence(chan_t c, lob_t inner)
+{
+  uint32_t seq = c->seq++;
+  lob_set_uint(inner,"seq",seq);
+  if(!c->out && seq - c->acked <= chan_limit(c)) return c;
+
+  inner->next = NULL;
+  if(c->out_end) c->out_end->next = inner;
+  else c->out = inner;
+  c->out_end = inner;
+  return NULL;
+}
+
 // adds to sending queue, expects valid packet
 chan_t chan_send(chan_t c, lob_t inner)
 {
@@ -145,6 +426,19 @@ chan_t chan_send(chan_t c, lob_t inner)
     return LOG("dropping packet, no link");
   }
 
+  if(c->window)
+  {
+    if(!chan_writable(c))
+    {
+      c->full = 1;
+      lob_free(inner);
+      return LOG_DEBUG("dropping packet, channel %u window is full",c->id);
+    }
+    if(chan_sequence(c, inner)) chan_transmit(c, inner, chan_ms(c));
+    if(!chan_writable(c)) c->full = 1;
+    return c;
+  }
+
   link_send(c->link, e3x_exchange_send(c->link->x, inner));
 
   lob_free(inner);
@@ -152,6 +446,74 @@ chan_t chan_send(chan_t c, lob_t inner)
   return c;
 }
 
+// encrypts the whole list in one pass, consumes the list
+chan_t chan_send_batch(chan_t c, lob_t inners)
+{
+  lob_t outers, outer;
+  uint8_t dropped = 0;
+  if(!c || !inners) return LOG("bad args");
+
+  LOG("channel send batch %d starting %s",c->id,lob_json(inners));
+  if(!c->link)
+  {
+    lob_freeall(inners);
+    return LOG("dropping packets, no link");
+  }
+
+  // reliable ones get their slots first and then go out together as the window allows
+  if(c->window)
+  {
+    lob_t inner, next, sending = NULL, end = NULL;
+    uint32_t now = chan_ms(c);
+    for(inner = inners; inner; inner = next)
+    {
+      next = inner->next;
+      inner->next = inner->prev = NULL;
+      if(!chan_writable(c))
+      {
+        lob_free(inner);
+        dropped++;
+        continue;
+      }
+      if(!chan_sequence(c, inner)) continue;
+      uint32_t seq = lob_get_uint(inner,"seq");
+      chan_sent_s *sent = &c->sent[seq % c->window];
+      if(seq > c->last) c->last = seq;
+      lob_set_uint(inner,"ack",c->ack);
+      lob_set_uint(inner,"win",c->told = chan_room(c));
+      lob_free(sent->packet);
+      sent->packet = inner;
+      sent->tries = 1;
+      sent->at = now;
+      if(end) end->next = inner;
+      else sending = inner;
+      end = inner;
+    }
+    if(!chan_writable(c)) c->full = 1;
+    if(dropped) LOG_DEBUG("dropped %u packets, channel %u window is full",dropped,c->id);
+    if(!sending) return dropped ? NULL : c;
+    if(c->seen == c->ack) c->acking = 0;
+    outers = e3x_exchange_send_batch(c->link->x, sending);
+    for(inner = sending; inner; inner = next)
+    {
+      next = inner->next;
+      inner->next = NULL;
+    }
+  }else{
+    outers = e3x_exchange_send_batch(c->link->x, inners);
+    lob_freeall(inners);
+  }
+
+  while((outer = lob_shift(outers)))
+  {
+    outers = outer->next;
+    outer->next = NULL;
+    link_send(c->link, outer);
+  }
+
+  return dropped ? NULL : c;
+}
+
 // generates local-only error packet for next chan_process()
 chan_t chan_err(chan_t c, char *msg)
 {
@@ -162,6 +524,7 @@ chan_t chan_err(chan_t c, char *msg)
   lob_set_raw(err, "end", 3, "true", 4);
   lob_set(err, "err", msg);
   c->in = lob_push(c->in, err); // top of the queue
+  c->in_len++;
   return c;
 }
 
@@ -189,11 +552,40 @@ chan_t chan_process(chan_t c, uint32_t now)
   }
   
   // fire receiving handlers
-  if(c->in && c->handle) c->handle(c, c->arg);
+  if(c->in && c->handle)
+  {
+    TRACE_START(at);
+    c->handle(c, c->arg);
+    TRACE_STOP(chan_handler, at, c);
+  }
+
+  if(c->window)
+  {
+    // the oldest unacked went missing, resend it and back off, any others it needs come back as misses
+    chan_sent_s *sent = &c->sent[(c->acked + 1) % c->window];
+    uint32_t ms = chan_ms(c);
+    if(c->acked + 1 < c->seq && sent->packet && ms - sent->at >= c->rto)
+    {
+      LOG_DEBUG("resending seq %u after %ums",c->acked + 1,ms - sent->at);
+      c->rto = (c->rto * 2 > CHAN_RTO_MAX) ? CHAN_RTO_MAX : c->rto * 2;
+      chan_transmit(c, sent->packet, ms);
+    }
+
+    // anything received that hasn't been acked by what the handler sent
+    if(c->acking && c->link) chan_ack(c);
+
+    // room to send again
+    if(c->full && chan_writable(c))
+    {
+      c->full = 0;
+      if(c->writable) c->writable(c, c->arg);
+    }
+  }
 
   if(c->state == CHAN_ENDED)
   {
     LOG("channel is now ended, freeing it");
+    if(c->link) LINK_STAT(c->link, chan_close, 1);
     c = chan_free(c);
   }
   
@@ -218,6 +610,52 @@ uint32_t chan_size(chan_t c)
   return size;
 }
 
+uint32_t chan_readable(chan_t c)
+{
+  if(!c) return 0;
+  return c->in_len;
+}
+
+// sent and waiting count against the limit and as much again queued behind it
+uint32_t chan_writable(chan_t c)
+{
+  uint32_t used, max;
+  if(!c) return 0;
+  if(!c->window) return 1;
+
+  used = c->seq - 1 - c->acked;
+  max = chan_limit(c) + c->window;
+  return (used < max) ? max - used : 0;
+}
+
+uint32_t chan_buffer(chan_t c, uint32_t packets)
+{
+  if(!c) return 0;
+  if(packets) c->buffer = packets;
+  return c->buffer;
+}
+
+// what's left of the link's mtu after this channel's headers
+uint32_t chan_mtu(chan_t c)
+{
+  uint32_t mtu, head;
+  lob_t packet;
+  if(!c || !(mtu = link_mtu(c->link))) return 0;
+
+  // as big as the seq and ack it goes out with will get for a while
+  packet = lob_new();
+  lob_set_uint(packet,"c",c->id);
+  if(c->window)
+  {
+    lob_set_uint(packet,"seq",c->seq + c->window);
+    lob_set_uint(packet,"ack",c->ack + c->window);
+    lob_set_uint(packet,"win",c->window);
+  }
+  head = (uint32_t)lob_len(packet);
+  lob_free(packet);
+  return (mtu > head) ? mtu - head : 1;
+}
+
 // set up internal handler for all incoming packets on this channel
 chan_t chan_handle(chan_t c, void (*handle)(chan_t c, void *arg), void *arg)
 {
@@ -228,3 +666,12 @@ chan_t chan_handle(chan_t c, void (*handle)(chan_t c, void *arg), void *arg)
 
   return c;
 }
+
+chan_t chan_on_writable(chan_t c, void (*writable)(chan_t c, void *arg))
+{
+  if(!c) return LOG("bad args");
+
+  c->writable = writable;
+
+  return c;
+}
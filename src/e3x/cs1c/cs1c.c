@@ -55,6 +55,8 @@ static ephemeral_t ephemeral_new(remote_t remote, lob_t outer);
 static void ephemeral_free(ephemeral_t ephemeral);
 static lob_t ephemeral_encrypt(ephemeral_t ephemeral, lob_t inner);
 static lob_t ephemeral_decrypt(ephemeral_t ephemeral, lob_t outer);
+static lob_t ephemeral_encrypt_batch(ephemeral_t ephemeral, lob_t inners);
+static lob_t ephemeral_decrypt_batch(ephemeral_t ephemeral, lob_t outers);
 
 
 static int RNG(uint8_t *p_dest, unsigned p_size)
@@ -77,10 +79,13 @@ e3x_cipher_t cs1c_init(lob_t options)
   // which alg's we support
   ret->alg = "HS256 ES256 JWK";
 
+  // empty head, token, iv and folded mac
+  ret->overhead = 2+16+4+4;
+
   // normal init stuff
   uECC_set_rng(&RNG);
 
-  // configure our callbacks (no RNG, default to platform's)
+  // configure our callbacks (no RNG, e3x_rand's chacha20 generator is the default)
   ret->hash = cipher_hash;
   ret->err = cipher_err;
   ret->generate = cipher_generate;
@@ -99,6 +104,8 @@ e3x_cipher_t cs1c_init(lob_t options)
   ret->ephemeral_free = (void (*)(void *))ephemeral_free;
   ret->ephemeral_encrypt = (lob_t (*)(void *, lob_t))ephemeral_encrypt;
   ret->ephemeral_decrypt = (lob_t (*)(void *, lob_t))ephemeral_decrypt;
+  ret->ephemeral_encrypt_batch = (lob_t (*)(void *, lob_t))ephemeral_encrypt_batch;
+  ret->ephemeral_decrypt_batch = (lob_t (*)(void *, lob_t))ephemeral_decrypt_batch;
 
   return ret;
 }
@@ -582,9 +589,68 @@ lob_t ephemeral_encrypt(ephemeral_t ephem, lob_t inner)
   return outer;
 }
 
+// same output as ephemeral_encrypt, but the aes key is expanded once and the macs run side by side
+#define BATCH_LANES 8
+lob_t ephemeral_encrypt_batch(ephemeral_t ephem, lob_t inners)
+{
+  lob_t outers = NULL, inner = inners;
+  lob_t outer[BATCH_LANES];
+  uint8_t iv[BATCH_LANES][16], hmac[BATCH_LANES][32], *ivs[BATCH_LANES], *outs[BATCH_LANES], *macs[BATCH_LANES];
+  const uint8_t *ins[BATCH_LANES], *keys[BATCH_LANES];
+  size_t lens[BATCH_LANES], klens[BATCH_LANES];
+  size_t count, i;
+
+  while(inner)
+  {
+    for(count = 0; inner && count < BATCH_LANES; inner = lob_next(inner), count++)
+    {
+      outer[count] = lob_new();
+      lens[count] = lob_len(inner);
+      if(!lob_body(outer[count],NULL,16+4+lens[count]+4))
+      {
+        for(i = 0; i <= count; i++) lob_free(outer[i]);
+        return lob_freeall(outers);
+      }
+
+      // copy in token and create/copy iv
+      memcpy(outer[count]->body,ephem->token,16);
+      memset(iv[count],0,16);
+      memcpy(iv[count],&(ephem->seq),4);
+      ephem->seq++;
+      memcpy(outer[count]->body+16,iv[count],4);
+
+      ivs[count] = iv[count];
+      ins[count] = lob_raw(inner);
+      outs[count] = outer[count]->body+16+4;
+
+      // mac key is the enckey and the iv as sent
+      memcpy(hmac[count],ephem->enckey,16);
+      memcpy(hmac[count]+16,outer[count]->body+16,4);
+      keys[count] = hmac[count];
+      klens[count] = 16+4;
+      macs[count] = hmac[count];
+    }
+
+    aes_128_ctr_multi(ephem->enckey,count,lens,ivs,ins,outs);
+    hmac_256_multi(keys,klens,(const uint8_t *const *)outs,lens,macs,count);
+
+    for(i = 0; i < count; i++)
+    {
+      fold3(hmac[i],outer[i]->body+16+4+lens[i]);
+      outers = lob_push(outers,outer[i]);
+    }
+  }
+
+  return outers;
+}
+
 lob_t ephemeral_decrypt(ephemeral_t ephem, lob_t outer)
 {
   uint8_t iv[16], hmac[32];
+  size_t inner_len;
+
+  if(outer->body_len <= (16+4+4)) return LOG("packet too small");
+  inner_len = outer->body_len-(16+4+4);
 
   memset(iv,0,16);
   memcpy(iv,outer->body+16,4);
@@ -592,14 +658,77 @@ lob_t ephemeral_decrypt(ephemeral_t ephem, lob_t outer)
   memcpy(hmac,ephem->deckey,16);
   memcpy(hmac+16,iv,4);
   // mac just the ciphertext
-  hmac_256(hmac,16+4,outer->body+16+4,outer->body_len-(4+16+4),hmac);
+  hmac_256(hmac,16+4,outer->body+16+4,inner_len,hmac);
   fold3(hmac,hmac);
 
   if(util_ct_memcmp(hmac,outer->body+(outer->body_len-4),4) != 0) return LOG("hmac failed");
 
-  // decrypt in place
-  aes_128_ctr(ephem->deckey,outer->body_len-(16+4+4),iv,outer->body+16+4,outer->body+16+4);
+  // decrypt to the front of the outer buffer (ctr is safe writing behind what it reads) and hand it over
+  aes_128_ctr(ephem->deckey,inner_len,iv,outer->body+16+4,lob_raw(outer));
+
+  return lob_take(outer, inner_len);
+}
+
+// same checks as ephemeral_decrypt, but the macs run side by side and the aes key is expanded once
+lob_t ephemeral_decrypt_batch(ephemeral_t ephem, lob_t outers)
+{
+  lob_t inners = NULL, outer = outers, inner;
+  lob_t pending[BATCH_LANES];
+  uint8_t iv[BATCH_LANES][16], hmac[BATCH_LANES][32], *ivs[BATCH_LANES], *outs[BATCH_LANES], *macs[BATCH_LANES];
+  const uint8_t *ins[BATCH_LANES], *keys[BATCH_LANES];
+  size_t lens[BATCH_LANES], klens[BATCH_LANES];
+  size_t count, valid, i;
+
+  while(outer)
+  {
+    for(count = 0; outer && count < BATCH_LANES; outer = lob_next(outer))
+    {
+      if(outer->body_len <= (16+4+4))
+      {
+        LOG("packet too small");
+        continue;
+      }
+      pending[count] = outer;
+      lens[count] = outer->body_len-(16+4+4);
+      memset(iv[count],0,16);
+      memcpy(iv[count],outer->body+16,4);
+      memcpy(hmac[count],ephem->deckey,16);
+      memcpy(hmac[count]+16,iv[count],4);
+      keys[count] = hmac[count];
+      klens[count] = 16+4;
+      ins[count] = outer->body+16+4;
+      macs[count] = hmac[count];
+      count++;
+    }
+
+    // mac just the ciphertexts
+    hmac_256_multi(keys,klens,ins,lens,macs,count);
+
+    // keep only the ones that verified
+    for(valid = i = 0; i < count; i++)
+    {
+      fold3(hmac[i],hmac[i]);
+      if(util_ct_memcmp(hmac[i],pending[i]->body+(pending[i]->body_len-4),4) != 0)
+      {
+        LOG("hmac failed");
+        continue;
+      }
+      pending[valid] = pending[i];
+      lens[valid] = lens[i];
+      memmove(iv[valid],iv[i],16);
+      ivs[valid] = iv[valid];
+      ins[valid] = ins[i];
+      outs[valid] = lob_raw(pending[i]);
+      valid++;
+    }
+
+    // decrypt to the front of each outer buffer and hand it over
+    aes_128_ctr_multi(ephem->deckey,valid,lens,ivs,ins,outs);
+    for(i = 0; i < valid; i++)
+    {
+      if((inner = lob_take(pending[i],lens[i]))) inners = lob_push(inners,inner);
+    }
+  }
 
-  // return parse attempt
-  return lob_parse(outer->body+16+4, outer->body_len-(16+4+4));
+  return inners;
 }
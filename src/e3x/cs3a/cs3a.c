@@ -33,7 +33,6 @@ typedef struct ephemeral_struct
 static uint8_t *cipher_hash(uint8_t *input, size_t len, uint8_t *output);
 static uint8_t *cipher_err(void);
 static uint8_t cipher_generate(lob_t keys, lob_t secrets);
-static uint8_t *cipher_rand(uint8_t *bytes, size_t len);
 
 static local_t local_new(lob_t keys, lob_t secrets);
 static void local_free(local_t local);
@@ -74,12 +73,14 @@ e3x_cipher_t cs3a_init(lob_t options)
   // which alg's we support
   ret->alg = "ED25519";
 
+  // empty head, token, nonce and mac
+  ret->overhead = 2+16+24+crypto_secretbox_MACBYTES;
+
   // normal init stuff
   randombytes_stir();
 
-  // configure our callbacks
+  // configure our callbacks (no RNG, nonces come from e3x_rand, keypairs still from libsodium)
   ret->hash = cipher_hash;
-  ret->rand = cipher_rand;
   ret->err = cipher_err;
   ret->generate = cipher_generate;
 
@@ -112,12 +113,6 @@ uint8_t *cipher_err(void)
   return 0;
 }
 
-uint8_t *cipher_rand(uint8_t *bytes, size_t len)
-{
-  randombytes_buf((void * const)bytes, len);
-  return bytes;
-}
-
 uint8_t cipher_generate(lob_t keys, lob_t secrets)
 {
   uint8_t secret[crypto_box_SECRETKEYBYTES], key[crypto_box_PUBLICKEYBYTES];
@@ -277,7 +272,7 @@ lob_t remote_encrypt(remote_t remote, local_t local, lob_t inner)
 
   // copy in the ephemeral public key/nonce
   memcpy(outer->body, remote->ekey, 32);
-  randombytes(nonce,24);
+  e3x_rand(nonce,24);
   memcpy(outer->body+32, nonce, 24);
 
   // get the shared secret to create the nonce+key for the open aes
@@ -362,7 +357,7 @@ lob_t ephemeral_encrypt(ephemeral_t ephem, lob_t inner)
 
   // copy in token and create nonce
   memcpy(outer->body,ephem->token,16);
-  randombytes(outer->body+16,24);
+  e3x_rand(outer->body+16,24);
 
   crypto_secretbox_easy(outer->body+16+24,
     lob_raw(inner),
@@ -376,11 +371,17 @@ lob_t ephemeral_encrypt(ephemeral_t ephem, lob_t inner)
 
 lob_t ephemeral_decrypt(ephemeral_t ephem, lob_t outer)
 {
-  crypto_secretbox_open_easy(outer->body+16+24,
+  size_t inner_len;
+
+  if(outer->body_len <= (16+24+crypto_secretbox_MACBYTES)) return LOG("packet too small");
+  inner_len = outer->body_len-(16+24+crypto_secretbox_MACBYTES);
+
+  // open to the front of the outer buffer and hand it over as the inner
+  if(crypto_secretbox_open_easy(lob_raw(outer),
     outer->body+16+24,
     outer->body_len-(16+24),
     outer->body+16,
-    ephem->deckey);
+    ephem->deckey) != 0) return LOG("secretbox open failed");
 
-  return lob_parse(outer->body+16+24, outer->body_len-(16+24+crypto_secretbox_MACBYTES));
+  return lob_take(outer, inner_len);
 }
@@ -47,7 +47,7 @@ lob_t e3x_generate(void)
 }
 
 
-static uint8_t (*frandom)(void) = (uint8_t (*)(void))util_sys_random;
+static uint8_t (*frandom)(void) = NULL;
 
 // set a callback for random
 void e3x_random(uint8_t (*frand)(void))
@@ -55,6 +55,109 @@ void e3x_random(uint8_t (*frand)(void))
   frandom = frand;
 }
 
+// keystream is made this many bytes at a time, the first 40 of every refill become the next key+nonce
+#define DRBG_BUF 1024
+#define DRBG_SEED 40
+// fresh OS entropy after this much output
+#define DRBG_RESEED (1024*1024)
+// bulk requests bigger than the buffer get their own one-shot key per chunk
+#define DRBG_CHUNK (1024*1024*1024)
+
+// bumped in a forked child so every thread state copied from the parent reseeds
+static uint32_t drbg_forks = 0;
+
+#if defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#include <pthread.h>
+static pthread_once_t drbg_once = PTHREAD_ONCE_INIT;
+static void drbg_forked(void) { drbg_forks++; }
+static void drbg_atfork(void) { pthread_atfork(NULL, NULL, drbg_forked); }
+#define DRBG_WATCH() pthread_once(&drbg_once, drbg_atfork)
+#else
+#define DRBG_WATCH()
+#endif
+
+// per-thread chacha20 state, fast-key-erasure style so nothing already handed out can be recovered
+static UTIL_TLS struct drbg_struct
+{
+  uint8_t buf[DRBG_BUF];
+  uint32_t at; // next unused byte in buf, DRBG_BUF when empty
+  uint32_t forks; // drbg_forks when seeded
+  size_t served;
+  uint8_t seeded;
+} drbg;
+
+static void drbg_refill(void)
+{
+  uint8_t seed[DRBG_SEED];
+  memcpy(seed,drbg.buf,DRBG_SEED);
+  memset(drbg.buf,0,DRBG_BUF);
+  chacha20(seed,seed+32,drbg.buf,DRBG_BUF);
+  memset(seed,0,DRBG_SEED);
+  drbg.at = DRBG_SEED;
+}
+
+static void drbg_seed(void)
+{
+  uint8_t i;
+  DRBG_WATCH();
+  if(util_sys_entropy(drbg.buf,DRBG_SEED) != 0)
+  {
+    // no OS source, the libc generator is the best there is
+    LOG_WARN("no entropy source, seeding from util_sys_random");
+    for(i=0;i<DRBG_SEED;i++) drbg.buf[i] ^= (uint8_t)util_sys_random();
+  }
+  drbg.forks = drbg_forks;
+  drbg.served = 0;
+  drbg.seeded = 1;
+  drbg_refill();
+}
+
+// copy out keystream, wiping what's used
+static void drbg_take(uint8_t *out, size_t len)
+{
+  size_t chunk;
+  while(len)
+  {
+    if(drbg.at >= DRBG_BUF) drbg_refill();
+    chunk = DRBG_BUF - drbg.at;
+    if(chunk > len) chunk = len;
+    memcpy(out,drbg.buf+drbg.at,chunk);
+    memset(drbg.buf+drbg.at,0,chunk);
+    drbg.at += (uint32_t)chunk;
+    out += chunk;
+    len -= chunk;
+  }
+}
+
+static uint8_t *drbg_rand(uint8_t *bytes, size_t len)
+{
+  uint8_t key[DRBG_SEED];
+  uint8_t *x = bytes;
+  uint32_t chunk;
+
+  if(!drbg.seeded || drbg.served >= DRBG_RESEED || drbg.forks != drbg_forks) drbg_seed();
+  drbg.served += len;
+
+  if(len <= DRBG_BUF)
+  {
+    drbg_take(bytes,len);
+    return bytes;
+  }
+
+  // big ones are written straight into the caller's buffer
+  while(len)
+  {
+    chunk = (len > DRBG_CHUNK) ? DRBG_CHUNK : (uint32_t)len;
+    drbg_take(key,DRBG_SEED);
+    memset(x,0,chunk);
+    chacha20(key,key+32,x,chunk);
+    x += chunk;
+    len -= chunk;
+  }
+  memset(key,0,DRBG_SEED);
+  return bytes;
+}
+
 // random bytes, from a supported cipher set
 uint8_t *e3x_rand(uint8_t *bytes, size_t len)
 {
@@ -62,7 +165,8 @@ uint8_t *e3x_rand(uint8_t *bytes, size_t len)
   if(!bytes || !len) return bytes;
   if(e3x_cipher_default && e3x_cipher_default->rand) return e3x_cipher_default->rand(bytes, len);
 
-  // crypto lib didn't provide one, use platform's RNG
+  // crypto lib didn't provide one, use our own unless the app supplied a source
+  if(!frandom) return drbg_rand(bytes, len);
   while(len-- > 0)
   {
     *x = frandom();
@@ -206,12 +206,44 @@ lob_t e3x_exchange_receive(e3x_exchange_t x, lob_t outer)
   lob_t inner;
   if(!x || !outer) return LOG("invalid args");
   if(!x->ephem) return LOG("no handshake");
+  TRACE_START(at);
   inner = x->cs->ephemeral_decrypt(x->ephem,outer);
+  TRACE_STOP(exchange_receive, at, x);
   if(!inner) return LOG("decryption failed %s",x->cs->err());
   LOG("decrypted head %d body %d",inner->head_len,inner->body_len);
   return inner;
 }
 
+// decrypts a whole list at once when the cipher set can amortize it, failures are dropped
+lob_t e3x_exchange_receive_batch(e3x_exchange_t x, lob_t outers)
+{
+  lob_t inner, outer, inners = NULL;
+  uint32_t count = 0;
+  if(!x || !outers) return LOG("invalid args");
+  if(!x->ephem) return LOG("no handshake");
+  for(outer = outers;outer;outer = lob_next(outer)) count++;
+  TRACE_START(at);
+
+  if(x->cs->ephemeral_decrypt_batch)
+  {
+    inners = x->cs->ephemeral_decrypt_batch(x->ephem,outers);
+    TRACE_STOP_EACH(exchange_receive, at, x, count);
+    return inners;
+  }
+
+  for(outer = outers;outer;outer = lob_next(outer))
+  {
+    if(!(inner = x->cs->ephemeral_decrypt(x->ephem,outer)))
+    {
+      LOG("decryption failed %s",x->cs->err());
+      continue;
+    }
+    inners = lob_push(inners,inner);
+  }
+  TRACE_STOP_EACH(exchange_receive, at, x, count);
+  return inners;
+}
+
 // comes from channel
 lob_t e3x_exchange_send(e3x_exchange_t x, lob_t inner)
 {
@@ -224,6 +256,33 @@ lob_t e3x_exchange_send(e3x_exchange_t x, lob_t inner)
   return outer;
 }
 
+// encrypts a whole list at once when the cipher set can amortize it, otherwise one at a time
+lob_t e3x_exchange_send_batch(e3x_exchange_t x, lob_t inners)
+{
+  lob_t inner, outer, outers = NULL;
+  if(!x || !inners) return LOG("invalid args");
+  if(!x->ephem) return LOG("no handshake");
+  LOG("encrypting batch starting head %d body %d",inners->head_len,inners->body_len);
+
+  if(x->cs->ephemeral_encrypt_batch)
+  {
+    outers = x->cs->ephemeral_encrypt_batch(x->ephem,inners);
+    if(!outers) return LOG("batch encryption failed %s",x->cs->err());
+    return outers;
+  }
+
+  for(inner = inners;inner;inner = lob_next(inner))
+  {
+    if(!(outer = x->cs->ephemeral_encrypt(x->ephem,inner)))
+    {
+      lob_freeall(outers);
+      return LOG("encryption failed %s",x->cs->err());
+    }
+    outers = lob_push(outers,outer);
+  }
+  return outers;
+}
+
 // validate the next incoming channel id from the packet, or return the next avail outgoing channel id
 uint32_t e3x_exchange_cid(e3x_exchange_t x, lob_t incoming)
 {
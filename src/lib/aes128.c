@@ -877,3 +877,26 @@ int mbedtls_aes_crypt_ctr( mbedtls_aes_context *ctx,
 }
 
 #endif
+
+// several independent ctr streams under one key, the key schedule is only expanded once
+#ifndef AES_EXTERNAL
+void aes_128_ctr_multi(unsigned char *key, size_t count, const size_t length[], unsigned char *nonce_counter[], const unsigned char *const input[], unsigned char *output[])
+{
+  mbedtls_aes_context ctx;
+  unsigned char block[16];
+  size_t i, off;
+
+  mbedtls_aes_setkey_enc(&ctx,key,128);
+  for(i = 0; i < count; i++)
+  {
+    off = 0;
+    mbedtls_aes_crypt_ctr(&ctx,length[i],&off,nonce_counter[i],block,input[i],output[i]);
+  }
+}
+#else
+void aes_128_ctr_multi(unsigned char *key, size_t count, const size_t length[], unsigned char *nonce_counter[], const unsigned char *const input[], unsigned char *output[])
+{
+  size_t i;
+  for(i = 0; i < count; i++) aes_128_ctr(key,length[i],nonce_counter[i],input[i],output[i]);
+}
+#endif
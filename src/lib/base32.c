@@ -21,6 +21,139 @@
 
 #include "telehash.h"
 
+// whole 16 character / 10 byte blocks are done with vector shuffles when the CPU has them, anything
+// the fast path can't take as-is (whitespace, mistyped digits, invalid chars) is left to the byte loop
+// from that block on, define BASE32_NO_ACCEL to build only the byte loops
+
+#if !defined(BASE32_NO_ACCEL) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BASE32_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#if !defined(BASE32_NO_ACCEL) && defined(__aarch64__) && defined(__ARM_NEON)
+#define BASE32_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef BASE32_SSSE3
+
+// 16 chars to 10 bytes, 0 if the block has anything but a-z A-Z 2-7
+__attribute__((target("ssse3")))
+static int decode_block_ssse3(const char *in, uint8_t *out)
+{
+  __m128i c = _mm_loadu_si128((const __m128i *)in);
+  __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+  __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a'-1)), _mm_cmpgt_epi8(_mm_set1_epi8('z'+1), lower));
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('2'-1)), _mm_cmpgt_epi8(_mm_set1_epi8('7'+1), c));
+  if(_mm_movemask_epi8(_mm_or_si128(alpha, digit)) != 0xFFFF) return 0;
+
+  // 5 bit values, then pairs to 10 bits, pairs of those to 20, and each half-group of 20 joined to 40
+  __m128i v = _mm_or_si128(_mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a'))), _mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('2'-26))));
+  v = _mm_maddubs_epi16(v, _mm_set1_epi16(0x0120));
+  v = _mm_madd_epi16(v, _mm_set1_epi32(0x00010400));
+  v = _mm_or_si128(_mm_slli_epi64(_mm_and_si128(v, _mm_set_epi32(0, -1, 0, -1)), 20), _mm_srli_epi64(v, 32));
+  v = _mm_shuffle_epi8(v, _mm_setr_epi8(4,3,2,1,0, 12,11,10,9,8, -1,-1,-1,-1,-1,-1));
+
+  uint8_t tmp[16];
+  _mm_storeu_si128((__m128i *)tmp, v);
+  memcpy(out, tmp, 10);
+  return 1;
+}
+
+// 10 bytes (16 readable) to 16 chars
+__attribute__((target("ssse3")))
+static void encode_block_ssse3(const uint8_t *in, char *out)
+{
+  __m128i x = _mm_loadu_si128((const __m128i *)in);
+
+  // each 16 bit lane gets the two bytes its 5 bits straddle, big endian, then shifts them down
+  __m128i mult = _mm_setr_epi16(32, 1024, 128, 4096, 512, 64, 2048, 256);
+  __m128i a = _mm_shuffle_epi8(x, _mm_setr_epi8(1,0, 1,0, 2,1, 2,1, 3,2, 4,3, 4,3, 5,4));
+  __m128i b = _mm_shuffle_epi8(x, _mm_setr_epi8(6,5, 6,5, 7,6, 7,6, 8,7, 9,8, 9,8, 10,9));
+  a = _mm_and_si128(_mm_mulhi_epu16(a, mult), _mm_set1_epi16(0x1F));
+  b = _mm_and_si128(_mm_mulhi_epu16(b, mult), _mm_set1_epi16(0x1F));
+  __m128i v = _mm_packus_epi16(a, b);
+
+  // 0-25 are a-z, 26-31 are 2-7
+  __m128i high = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(25)), _mm_set1_epi8('a'-'2'+26));
+  v = _mm_add_epi8(v, _mm_sub_epi8(_mm_set1_epi8('a'), high));
+  _mm_storeu_si128((__m128i *)out, v);
+}
+
+#endif // BASE32_SSSE3
+
+#ifdef BASE32_NEON
+
+static int decode_block_neon(const char *in, uint8_t *out)
+{
+  uint8x16_t c = vld1q_u8((const uint8_t *)in);
+  uint8x16_t lower = vorrq_u8(c, vdupq_n_u8(0x20));
+  uint8x16_t alpha = vcleq_u8(vsubq_u8(lower, vdupq_n_u8('a')), vdupq_n_u8(25));
+  uint8x16_t digit = vcleq_u8(vsubq_u8(c, vdupq_n_u8('2')), vdupq_n_u8(5));
+  if(vminvq_u8(vorrq_u8(alpha, digit)) != 0xFF) return 0;
+
+  uint8x16_t v = vbslq_u8(alpha, vsubq_u8(lower, vdupq_n_u8('a')), vsubq_u8(c, vdupq_n_u8('2'-26)));
+
+  // same joins as the x86 path, 5 to 10 to 20 to 40 bits
+  uint16x8_t p = vreinterpretq_u16_u8(v);
+  p = vorrq_u16(vshlq_n_u16(vandq_u16(p, vdupq_n_u16(0xFF)), 5), vshrq_n_u16(p, 8));
+  uint32x4_t q = vreinterpretq_u32_u16(p);
+  q = vorrq_u32(vshlq_n_u32(vandq_u32(q, vdupq_n_u32(0xFFFF)), 10), vshrq_n_u32(q, 16));
+  uint64x2_t r = vreinterpretq_u64_u32(q);
+  r = vorrq_u64(vshlq_n_u64(vandq_u64(r, vdupq_n_u64(0xFFFFFFFF)), 20), vshrq_n_u64(r, 32));
+  static const uint8_t order[16] = {4,3,2,1,0, 12,11,10,9,8, 255,255,255,255,255,255};
+  uint8x16_t bytes = vqtbl1q_u8(vreinterpretq_u8_u64(r), vld1q_u8(order));
+
+  uint8_t tmp[16];
+  vst1q_u8(tmp, bytes);
+  memcpy(out, tmp, 10);
+  return 1;
+}
+
+static void encode_block_neon(const uint8_t *in, char *out)
+{
+  static const uint8_t pick[32] = {1,0, 1,0, 2,1, 2,1, 3,2, 4,3, 4,3, 5,4, 6,5, 6,5, 7,6, 7,6, 8,7, 9,8, 9,8, 10,9};
+  static const int16_t shift[8] = {-11, -6, -9, -4, -7, -10, -5, -8};
+  uint8x16_t x = vld1q_u8(in);
+  int16x8_t s = vld1q_s16(shift);
+  uint16x8_t a = vreinterpretq_u16_u8(vqtbl1q_u8(x, vld1q_u8(pick)));
+  uint16x8_t b = vreinterpretq_u16_u8(vqtbl1q_u8(x, vld1q_u8(pick+16)));
+  a = vandq_u16(vshlq_u16(a, s), vdupq_n_u16(0x1F));
+  b = vandq_u16(vshlq_u16(b, s), vdupq_n_u16(0x1F));
+  uint8x16_t v = vcombine_u8(vmovn_u16(a), vmovn_u16(b));
+
+  uint8x16_t high = vandq_u8(vcgtq_u8(v, vdupq_n_u8(25)), vdupq_n_u8('a'-'2'+26));
+  v = vaddq_u8(v, vsubq_u8(vdupq_n_u8('a'), high));
+  vst1q_u8((uint8_t *)out, v);
+}
+
+#endif // BASE32_NEON
+
+// how many whole blocks are done already, 0 when there's no vector unit to use
+static size_t decode_blocks(const char *encoded, size_t length, uint8_t *result, size_t bufSize)
+{
+  size_t done = 0;
+#if defined(BASE32_SSSE3)
+  if(!__builtin_cpu_supports("ssse3")) return 0;
+  while(length - done >= 16 && bufSize - (done/16)*10 >= 10 && decode_block_ssse3(encoded+done, result+(done/16)*10)) done += 16;
+#elif defined(BASE32_NEON)
+  while(length - done >= 16 && bufSize - (done/16)*10 >= 10 && decode_block_neon(encoded+done, result+(done/16)*10)) done += 16;
+#endif
+  return done/16;
+}
+
+static size_t encode_blocks(const uint8_t *data, size_t length, char *result, size_t bufSize)
+{
+  size_t done = 0;
+#if defined(BASE32_SSSE3)
+  if(!__builtin_cpu_supports("ssse3")) return 0;
+  for(;length - done*10 >= 16 && bufSize - done*16 > 16;done++) encode_block_ssse3(data+done*10, result+done*16);
+#elif defined(BASE32_NEON)
+  for(;length - done*10 >= 16 && bufSize - done*16 > 16;done++) encode_block_neon(data+done*10, result+done*16);
+#endif
+  return done;
+}
+
 size_t base32_decode(const char *encoded, size_t length, uint8_t *result, size_t bufSize) {
   int buffer = 0;
   size_t bitsLeft = 0;
@@ -28,6 +161,9 @@ size_t base32_decode(const char *encoded, size_t length, uint8_t *result, size_t
   const char *ptr = encoded;
   if(!encoded || !result  || bufSize <= 0) return 0;
   if(!length) length = strlen(encoded);
+  count = decode_blocks(encoded, length, result, bufSize);
+  ptr += count*16;
+  count *= 10;
   for (; (size_t)(ptr-encoded) < length && count < bufSize; ++ptr) {
     uint8_t ch = (uint8_t)*ptr;
     if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '-') {
@@ -70,6 +206,10 @@ size_t base32_decode(const char *encoded, size_t length, uint8_t *result, size_t
 size_t base32_encode(const uint8_t *data, size_t length, char *result, size_t bufSize) {
   if (!data || !result || !bufSize || !length) return 0;
   size_t count = 0;
+  size_t blocks = encode_blocks(data, length, result, bufSize);
+  data += blocks*10;
+  length -= blocks*10;
+  count = blocks*16;
   if (length > 0) {
     int buffer = data[0];
     size_t next = 1;
@@ -3,6 +3,164 @@
 #include <stdint.h>
 #include <string.h>
 
+// whole blocks of clean input are done with vector lookups when the CPU has them, the byte loops pick up
+// from the first block holding anything else (padding, a NUL, invalid chars), define BASE64_NO_ACCEL to
+// build only the byte loops
+
+#if !defined(BASE64_NO_ACCEL) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_SSSE3
+#include <tmmintrin.h>
+
+// 12 bytes to 16 chars, 16 chars to 12 bytes
+#define BLOCK_BYTES 12
+#define BLOCK_CHARS 16
+
+// 16 chars to 12 bytes, 0 if the block has anything outside the alphabet
+__attribute__((target("ssse3")))
+static int decode_block(const char *in, uint8_t *out)
+{
+  __m128i c = _mm_loadu_si128((const __m128i *)in);
+#define RANGE(lo,hi) _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8((lo)-1)), _mm_cmpgt_epi8(_mm_set1_epi8((hi)+1), c))
+  __m128i upper = RANGE('A','Z');
+  __m128i lower = RANGE('a','z');
+  __m128i digit = RANGE('0','9');
+  __m128i s62 = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('+')), _mm_cmpeq_epi8(c, _mm_set1_epi8('-')));
+  __m128i s63 = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('/')), _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+#undef RANGE
+  __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(s62, s63)));
+  if(_mm_movemask_epi8(valid) != 0xFFFF) return 0;
+
+  // each char's offset to its 6 bit value, picked by which range it fell in
+  __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+  shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26-'a')));
+  shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52-'0')));
+  __m128i v = _mm_add_epi8(_mm_andnot_si128(_mm_or_si128(s62, s63), _mm_add_epi8(c, shift)), _mm_and_si128(s62, _mm_set1_epi8(62)));
+  v = _mm_or_si128(v, _mm_and_si128(s63, _mm_set1_epi8(63)));
+
+  // 6 bit pairs to 12, pairs of those to 24, then the three bytes of each lane in order
+  v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+  v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+  v = _mm_shuffle_epi8(v, _mm_setr_epi8(2,1,0, 6,5,4, 10,9,8, 14,13,12, -1,-1,-1,-1));
+
+  uint8_t tmp[16];
+  _mm_storeu_si128((__m128i *)tmp, v);
+  memcpy(out, tmp, 12);
+  return 1;
+}
+
+// 12 bytes (16 readable) to 16 chars
+__attribute__((target("ssse3")))
+static void encode_block(const uint8_t *in, char *out)
+{
+  __m128i x = _mm_loadu_si128((const __m128i *)in);
+
+  // spread each 3 bytes over a 32 bit lane and pull the four 6 bit indexes into its bytes
+  x = _mm_shuffle_epi8(x, _mm_setr_epi8(1,0,2,1, 4,3,5,4, 7,6,8,7, 10,9,11,10));
+  __m128i a = _mm_mulhi_epu16(_mm_and_si128(x, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+  __m128i b = _mm_mullo_epi16(_mm_and_si128(x, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+  __m128i idx = _mm_or_si128(a, b);
+
+  // 0-25 map to slot 13 ('A'), 26-51 to slot 0, 52-61 to 1-10, 62 and 63 to 11 and 12
+  __m128i slot = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+  slot = _mm_or_si128(slot, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+  __m128i offsets = _mm_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '-'-62, '_'-63, 'A', 0, 0);
+  _mm_storeu_si128((__m128i *)out, _mm_add_epi8(idx, _mm_shuffle_epi8(offsets, slot)));
+}
+
+#endif // BASE64_SSSE3
+
+#if !defined(BASE64_NO_ACCEL) && !defined(BASE64_SSSE3) && defined(__aarch64__) && defined(__ARM_NEON)
+#define BASE64_NEON
+#include <arm_neon.h>
+
+// structured loads do the (de)interleaving, so blocks are 48 bytes / 64 chars
+#define BLOCK_BYTES 48
+#define BLOCK_CHARS 64
+
+static uint8x16_t decode_lane(uint8x16_t c, uint8x16_t *valid)
+{
+  uint8x16_t upper = vcleq_u8(vsubq_u8(c, vdupq_n_u8('A')), vdupq_n_u8(25));
+  uint8x16_t lower = vcleq_u8(vsubq_u8(c, vdupq_n_u8('a')), vdupq_n_u8(25));
+  uint8x16_t digit = vcleq_u8(vsubq_u8(c, vdupq_n_u8('0')), vdupq_n_u8(9));
+  uint8x16_t s62 = vorrq_u8(vceqq_u8(c, vdupq_n_u8('+')), vceqq_u8(c, vdupq_n_u8('-')));
+  uint8x16_t s63 = vorrq_u8(vceqq_u8(c, vdupq_n_u8('/')), vceqq_u8(c, vdupq_n_u8('_')));
+  *valid = vandq_u8(*valid, vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, vorrq_u8(s62, s63))));
+
+  uint8x16_t v = vandq_u8(upper, vsubq_u8(c, vdupq_n_u8('A')));
+  v = vorrq_u8(v, vandq_u8(lower, vsubq_u8(c, vdupq_n_u8('a'-26))));
+  v = vorrq_u8(v, vandq_u8(digit, vaddq_u8(c, vdupq_n_u8(52-'0'))));
+  v = vorrq_u8(v, vandq_u8(s62, vdupq_n_u8(62)));
+  return vorrq_u8(v, vandq_u8(s63, vdupq_n_u8(63)));
+}
+
+static int decode_block(const char *in, uint8_t *out)
+{
+  uint8x16x4_t c = vld4q_u8((const uint8_t *)in);
+  uint8x16_t valid = vdupq_n_u8(0xFF);
+  uint8x16_t a = decode_lane(c.val[0], &valid);
+  uint8x16_t b = decode_lane(c.val[1], &valid);
+  uint8x16_t d = decode_lane(c.val[2], &valid);
+  uint8x16_t e = decode_lane(c.val[3], &valid);
+  if(vminvq_u8(valid) != 0xFF) return 0;
+
+  uint8x16x3_t r;
+  r.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+  r.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(d, 2));
+  r.val[2] = vorrq_u8(vshlq_n_u8(d, 6), e);
+  vst3q_u8(out, r);
+  return 1;
+}
+
+static void encode_block(const uint8_t *in, char *out)
+{
+  static const uint8_t table[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  uint8x16x4_t lut = {{vld1q_u8(table), vld1q_u8(table+16), vld1q_u8(table+32), vld1q_u8(table+48)}};
+  uint8x16x3_t x = vld3q_u8(in);
+  uint8x16x4_t r;
+  r.val[0] = vshrq_n_u8(x.val[0], 2);
+  r.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(x.val[0], 4), vshrq_n_u8(x.val[1], 4)), vdupq_n_u8(0x3F));
+  r.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(x.val[1], 2), vshrq_n_u8(x.val[2], 6)), vdupq_n_u8(0x3F));
+  r.val[3] = vandq_u8(x.val[2], vdupq_n_u8(0x3F));
+  r.val[0] = vqtbl4q_u8(lut, r.val[0]);
+  r.val[1] = vqtbl4q_u8(lut, r.val[1]);
+  r.val[2] = vqtbl4q_u8(lut, r.val[2]);
+  r.val[3] = vqtbl4q_u8(lut, r.val[3]);
+  vst4q_u8((uint8_t *)out, r);
+}
+
+#endif // BASE64_NEON
+
+#ifndef BLOCK_BYTES
+#define BLOCK_BYTES 3
+#define BLOCK_CHARS 4
+#endif
+
+// how many whole blocks are done already, 0 when there's no vector unit to use
+static size_t decode_blocks(const char *str, size_t len, uint8_t *out)
+{
+  size_t done = 0;
+#if defined(BASE64_SSSE3) || defined(BASE64_NEON)
+#ifdef BASE64_SSSE3
+  if(!__builtin_cpu_supports("ssse3")) return 0;
+#endif
+  for(;len - done*BLOCK_CHARS >= BLOCK_CHARS && decode_block(str + done*BLOCK_CHARS, out + done*BLOCK_BYTES);done++);
+#endif
+  return done;
+}
+
+static size_t encode_blocks(const uint8_t *str, size_t len, char *out)
+{
+  size_t done = 0;
+#if defined(BASE64_SSSE3) || defined(BASE64_NEON)
+#ifdef BASE64_SSSE3
+  if(!__builtin_cpu_supports("ssse3")) return 0;
+#endif
+  // x86 loads 16 bytes for each 12, and the byte loop always needs something left to pad
+  for(;len - done*BLOCK_BYTES > ((BLOCK_BYTES < 16) ? 15 : BLOCK_BYTES);done++) encode_block(str + done*BLOCK_BYTES, out + done*BLOCK_CHARS);
+#endif
+  return done;
+}
+
 // decode str of len into out (must be base64_decode_length(len) bit), return actual decoded len
 size_t base64_decoder(const char *str, size_t len, uint8_t *save)
 {
@@ -31,7 +189,18 @@ size_t base64_decoder(const char *str, size_t len, uint8_t *save)
 
     d = dlast = phase = 0;
     start = out;
-    for (cur = (uint8_t*)str; *cur != '\0' && len; ++cur, --len)
+    cur = (uint8_t*)str;
+
+    // the counting-only mode stays in the byte loop, it never writes
+    if(save)
+    {
+        size_t blocks = decode_blocks(str, len, out);
+        cur += blocks*BLOCK_CHARS;
+        len -= blocks*BLOCK_CHARS;
+        out += blocks*BLOCK_BYTES;
+    }
+
+    for (; *cur != '\0' && len; ++cur, --len)
     {
         if(*cur & 0x80) return 0; // invalid
 
@@ -88,6 +257,11 @@ size_t base64_encoder(const uint8_t *str, size_t len, char *out)
 
     if(!str || !out || !len) return 0;
 
+    size_t blocks = encode_blocks(str, len, out);
+    str += blocks*BLOCK_BYTES;
+    len -= blocks*BLOCK_BYTES;
+    cur += blocks*BLOCK_CHARS;
+
     for (i = 0; i < len; i += 3, str += 3)
     {
       s1 = (i+1<len)?str[1]:0;
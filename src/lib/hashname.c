@@ -9,15 +9,22 @@
 // how many csids can be used to make a hashname
 #define MAX_CSIDS 8
 
-// v* methods return this
-static struct hashname_struct hn_vtmp;
+// v* methods return this, one per thread
+static UTIL_TLS struct hashname_struct hn_vtmp;
+
+// bin is being replaced, drop anything encoded from its previous value
+static hashname_t hn_reset(hashname_t hn)
+{
+  hn->str[0] = hn->sstr[0] = 0;
+  return hn;
+}
 
 hashname_t hashname_dup(hashname_t id)
 {
   hashname_t hn;
   if(!(hn = malloc(sizeof (struct hashname_struct)))) return NULL;
   memset(hn,0,sizeof (struct hashname_struct));
-  if(id) memcpy(hn->bin, id->bin, 32);
+  if(id) memcpy(hn, id, sizeof (struct hashname_struct)); // keeps any encoded strings too
   return hn;
 }
 
@@ -31,26 +38,42 @@ hashname_t hashname_free(hashname_t hn)
 // validate a str is a base32 hashname, returns TEMPORARY hashname
 hashname_t hashname_vchar(const char *str)
 {
-  if(!str) return NULL;
+  return hashname_vchar_r(str, &hn_vtmp);
+}
+
+hashname_t hashname_vchar_r(const char *str, hashname_t hn)
+{
+  if(!str || !hn) return NULL;
+  hn_reset(hn);
   // decode will stop reading the first non-b32 char it sees, like a \0
-  if(base32_decode(str,52,hn_vtmp.bin,32) != 32) return NULL;
-  return &hn_vtmp;
+  if(base32_decode(str,52,hn->bin,32) != 32) return NULL;
+  return hn;
 }
 
 hashname_t hashname_vbin(const uint8_t *bin)
 {
-  if(!bin) return NULL;
-  memcpy(&hn_vtmp,bin,32);
-  return &hn_vtmp;
+  return hashname_vbin_r(bin, &hn_vtmp);
+}
+
+hashname_t hashname_vbin_r(const uint8_t *bin, hashname_t hn)
+{
+  if(!bin || !hn) return NULL;
+  memmove(hn->bin,bin,32);
+  return hn_reset(hn);
 }
 
 // temp hashname from intermediate values as hex/base32 key/value pairs
 hashname_t hashname_vkey(lob_t key, uint8_t csid)
+{
+  return hashname_vkey_r(key, csid, &hn_vtmp);
+}
+
+hashname_t hashname_vkey_r(lob_t key, uint8_t csid, hashname_t hn)
 {
   unsigned int i, start;
   uint8_t hash[64];
   char *id, *value, hexid[3];
-  if(!key) return LOG("invalid args");
+  if(!key || !hn) return LOG("invalid args");
   util_hex(&csid, 1, hexid);
   memset(hash,0,64);
 
@@ -85,17 +108,21 @@ hashname_t hashname_vkey(lob_t key, uint8_t csid)
   if(!keys) return LOG("no keys found in %s",lob_json(key));
   if(!i || i % 2 != 0) return LOG("invalid keys %d",i);
   
-  return hashname_vbin(hash);
+  return hashname_vbin_r(hash, hn);
 }
 
 hashname_t hashname_vkeys(lob_t keys)
 {
-  hashname_t hn;
+  return hashname_vkeys_r(keys, &hn_vtmp);
+}
+
+hashname_t hashname_vkeys_r(lob_t keys, hashname_t hn)
+{
   lob_t im;
 
-  if(!keys) return LOG("bad args");
+  if(!keys || !hn) return LOG("bad args");
   im = hashname_im(keys,0);
-  hn = hashname_vkey(im,0);
+  hn = hashname_vkey_r(im,0,hn);
   lob_free(im);
   return hn;
 }
@@ -107,13 +134,12 @@ uint8_t *hashname_bin(hashname_t hn)
   return hn->bin;
 }
 
-// 52 byte base32 string w/ \0 (TEMPORARY)
-static char hn_ctmp[53];
+// 52 byte base32 string w/ \0, only encoded once
 char *hashname_char(hashname_t hn)
 {
   if(!hn) return NULL;
-  base32_encode(hn->bin,32,hn_ctmp,53);
-  return hn_ctmp;
+  if(!hn->str[0]) base32_encode(hn->bin,32,hn->str,sizeof(hn->str));
+  return hn->str;
 }
 
 int hashname_cmp(hashname_t a, hashname_t b)
@@ -185,14 +211,12 @@ lob_t hashname_im(lob_t keys, uint8_t id)
 
 // working with short hashnames (5 bin bytes, 8 char bytes)
 
-// 8 byte base32 string w/ \0 (TEMPORARY)
+// 8 byte base32 string w/ \0, only encoded once
 char *hashname_short(hashname_t hn)
 {
-  static uint8_t tog = 1;
   if(!hn) return NULL;
-  tog = tog ? 0 : 26; // fit two short names in hn_ctmp for easier LOG() args
-  base32_encode(hn->bin,5,hn_ctmp+tog,53-tog);
-  return hn_ctmp+tog;
+  if(!hn->sstr[0]) base32_encode(hn->bin,5,hn->sstr,sizeof(hn->sstr));
+  return hn->sstr;
 }
 
 
@@ -206,18 +230,30 @@ int hashname_scmp(hashname_t a, hashname_t b)
 
 hashname_t hashname_schar(const char *str)
 {
-  if(!str) return NULL;
-  memset(hn_vtmp.bin,0,32);
-  if(base32_decode(str,8,hn_vtmp.bin,5) != 5) return NULL;
-  return &hn_vtmp;
+  return hashname_schar_r(str, &hn_vtmp);
+}
+
+hashname_t hashname_schar_r(const char *str, hashname_t hn)
+{
+  if(!str || !hn) return NULL;
+  memset(hn_reset(hn)->bin,0,32);
+  if(base32_decode(str,8,hn->bin,5) != 5) return NULL;
+  return hn;
 }
 
 hashname_t hashname_sbin(const uint8_t *bin)
 {
-  if(!bin) return NULL;
-  memset(hn_vtmp.bin,0,32);
-  memcpy(hn_vtmp.bin,bin,5);
-  return &hn_vtmp;
+  return hashname_sbin_r(bin, &hn_vtmp);
+}
+
+hashname_t hashname_sbin_r(const uint8_t *bin, hashname_t hn)
+{
+  uint8_t sbin[5];
+  if(!bin || !hn) return NULL;
+  memcpy(sbin,bin,5); // bin may point into hn
+  memset(hn->bin,0,32);
+  memcpy(hn->bin,sbin,5);
+  return hn_reset(hn);
 }
 
 // NULL unless is short
@@ -95,10 +95,13 @@ lob_t lob_parse(const uint8_t *raw, size_t len)
   hlen = util_sys_short(nlen);
   if(hlen > len - 2) return LOG_DEBUG("invalid head len");
 
+  TRACE_START(at);
   uint8_t *raw2 = NULL;
   if(!(raw2 = malloc(len))) return LOG_DEBUG("OOM");
   memcpy(raw2,raw,len);
-  return lob_direct(raw2, len); 
+  lob_t p = lob_direct(raw2, len);
+  TRACE_STOP(lob_parse, at, p);
+  return p;
 }
 
 lob_t lob_direct(uint8_t *raw, size_t len)
@@ -127,6 +130,22 @@ lob_t lob_direct(uint8_t *raw, size_t len)
   return p;
 }
 
+lob_t lob_take(lob_t from, size_t len)
+{
+  lob_t p;
+  if(!from || !from->raw) return LOG_DEBUG("bad args");
+  if(len > lob_len(from)) return LOG_DEBUG("invalid len");
+  if(!(p = lob_direct(from->raw, len))) return NULL;
+
+  // buffer belongs to the new one now, leave the old one empty
+  from->raw = from->head = from->body = NULL;
+  from->head_len = from->body_len = 0;
+  free(from->cache);
+  from->cache = NULL;
+
+  return p;
+}
+
 uint8_t *lob_head(lob_t p, uint8_t *head, size_t len)
 {
   uint16_t nlen;
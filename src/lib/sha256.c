@@ -125,6 +125,395 @@ static void compress (uint32_t *digest, uint32_t *chunk)
   digest[7] += h;
 }
 
+static const uint32_t initial_state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+// one independent message for the multi-buffer paths, state may already include a prefix (hmac pads)
+typedef struct sha256_lane_struct
+{
+  uint32_t state[8];
+  const uint8_t *in;
+  size_t len;
+  uint64_t bits; // total length hashed into state when done
+} sha256_lane_t;
+
+// ##### accelerated compress back-ends #####
+//
+// the digest/chunk word layout above is shared by every back-end so the buffering code doesn't care which
+// one is running, they are selected at runtime on first use and each one must reproduce the portable
+// compress() on a known block before it is trusted, define SHA256_NO_ACCEL to build only the portable one
+
+#if !defined(SHA256_NO_ACCEL) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if !defined(SHA256_NO_ACCEL) && defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+#define SHA256_ARMV8
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+#ifdef SHA256_X86
+
+// x86 SHA extensions, state is kept as ABEF/CDGH for the rnds2 instruction
+__attribute__((target("sha,sse4.1")))
+static void compress_shani (uint32_t *digest, uint32_t *chunk)
+{
+  __m128i state0, state1, abef, cdgh, msg, tmp, w[4];
+
+  tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&digest[0]), 0xB1); // CDAB
+  state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&digest[4]), 0x1B); // EFGH
+  state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0); // CDGH
+  abef = state0;
+  cdgh = state1;
+
+  // chunk words are already host order, no byte shuffle needed
+  for (int i = 0; i < 4; ++i)
+    w[i] = _mm_loadu_si128((const __m128i *)&chunk[i*4]);
+
+  for (int i = 0; i < 16; ++i)
+  {
+    __m128i cur = w[i&3];
+    msg = _mm_add_epi32(cur, _mm_loadu_si128((const __m128i *)&kk[i*4]));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+    if (i >= 3 && i < 15)
+    {
+      tmp = _mm_alignr_epi8(cur, w[(i-1)&3], 4);
+      w[(i+1)&3] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(i+1)&3], tmp), cur);
+    }
+    msg = _mm_shuffle_epi32(msg, 0x0E);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+    if (i >= 1 && i < 13)
+      w[(i-1)&3] = _mm_sha256msg1_epu32(w[(i-1)&3], cur);
+  }
+
+  state0 = _mm_add_epi32(state0, abef);
+  state1 = _mm_add_epi32(state1, cdgh);
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B); // FEBA
+  state1 = _mm_shuffle_epi32(state1, 0xB1); // DCHG
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+  state1 = _mm_alignr_epi8(state1, tmp, 8); // HGFE
+
+  _mm_storeu_si128((__m128i *)&digest[0], state0);
+  _mm_storeu_si128((__m128i *)&digest[4], state1);
+}
+
+// eight independent compress()es at once, one per 32bit lane
+#define X8_ROR(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define X8_XOR3(a, b, c) _mm256_xor_si256(_mm256_xor_si256((a), (b)), (c))
+
+__attribute__((target("avx2")))
+static void compress_x8 (uint32_t digest[8][8], uint32_t chunk[16][8])
+{
+  __m256i w[16], s[8], a, b, c, d, e, f, g, h;
+
+  for (int i = 0; i < 8; ++i)
+    s[i] = _mm256_loadu_si256((const __m256i *)digest[i]);
+  for (int i = 0; i < 16; ++i)
+    w[i] = _mm256_loadu_si256((const __m256i *)chunk[i]);
+  a = s[0]; b = s[1]; c = s[2]; d = s[3]; e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+  for (int i = 0; i < 64; ++i)
+  {
+    __m256i x = w[i&15];
+
+    if (i < 48)
+    {
+      __m256i w1 = w[(i+1)&15], w14 = w[(i+14)&15];
+      __m256i sig0 = X8_XOR3(X8_ROR(w1, 7), X8_ROR(w1, 18), _mm256_srli_epi32(w1, 3));
+      __m256i sig1 = X8_XOR3(X8_ROR(w14, 17), X8_ROR(w14, 19), _mm256_srli_epi32(w14, 10));
+      w[i&15] = _mm256_add_epi32(_mm256_add_epi32(x, sig0), _mm256_add_epi32(w[(i+9)&15], sig1));
+    }
+
+    __m256i maj = _mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_xor_si256(a, b)));
+    __m256i t2 = _mm256_add_epi32(X8_XOR3(X8_ROR(a, 2), X8_ROR(a, 13), X8_ROR(a, 22)), maj);
+    __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+    __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, X8_XOR3(X8_ROR(e, 6), X8_ROR(e, 11), X8_ROR(e, 25))),
+                   _mm256_add_epi32(_mm256_add_epi32(ch, _mm256_set1_epi32((int)kk[i])), x));
+
+    h = g;
+    g = f;
+    f = e;
+    e = _mm256_add_epi32(d, t1);
+    d = c;
+    c = b;
+    b = a;
+    a = _mm256_add_epi32(t1, t2);
+  }
+
+  s[0] = _mm256_add_epi32(s[0], a); s[1] = _mm256_add_epi32(s[1], b);
+  s[2] = _mm256_add_epi32(s[2], c); s[3] = _mm256_add_epi32(s[3], d);
+  s[4] = _mm256_add_epi32(s[4], e); s[5] = _mm256_add_epi32(s[5], f);
+  s[6] = _mm256_add_epi32(s[6], g); s[7] = _mm256_add_epi32(s[7], h);
+  for (int i = 0; i < 8; ++i)
+    _mm256_storeu_si256((__m256i *)digest[i], s[i]);
+}
+
+// only reads the cpu, so any thread can ask
+static void sha256_cpu (uint8_t *shani, uint8_t *avx2)
+{
+  unsigned int a, b, c, d;
+  *shani = *avx2 = 0;
+
+  if (!__get_cpuid(1, &a, &b, &c, &d)) return;
+  uint8_t ssse3 = (c >> 9) & 1, sse41 = (c >> 19) & 1, osxsave = (c >> 27) & 1, avx = (c >> 28) & 1;
+  if (__get_cpuid_max(0, NULL) < 7) return;
+  __cpuid_count(7, 0, a, b, c, d);
+  *shani = ((b >> 29) & 1) && ssse3 && sse41;
+
+  // AVX2 also needs the OS to be saving the ymm state
+  if (osxsave && avx && ((b >> 5) & 1))
+  {
+    uint32_t xlo, xhi;
+    __asm__ ("xgetbv" : "=a"(xlo), "=d"(xhi) : "c"(0));
+    *avx2 = (xlo & 6) == 6;
+  }
+}
+
+#endif // SHA256_X86
+
+#ifdef SHA256_ARMV8
+
+// ARMv8 crypto extensions, the state maps directly to ABCD/EFGH
+static void compress_armv8 (uint32_t *digest, uint32_t *chunk)
+{
+  uint32x4_t state0, state1, abcd, efgh, tmp, w[4];
+
+  state0 = vld1q_u32(&digest[0]);
+  state1 = vld1q_u32(&digest[4]);
+  abcd = state0;
+  efgh = state1;
+
+  for (int i = 0; i < 4; ++i)
+    w[i] = vld1q_u32(&chunk[i*4]);
+
+  for (int i = 0; i < 16; ++i)
+  {
+    uint32x4_t msg = vaddq_u32(w[i&3], vld1q_u32(&kk[i*4]));
+    if (i < 12)
+      w[i&3] = vsha256su0q_u32(w[i&3], w[(i+1)&3]);
+    tmp = state0;
+    state0 = vsha256hq_u32(state0, state1, msg);
+    state1 = vsha256h2q_u32(state1, tmp, msg);
+    if (i < 12)
+      w[i&3] = vsha256su1q_u32(w[i&3], w[(i+2)&3], w[(i+3)&3]);
+  }
+
+  vst1q_u32(&digest[0], vaddq_u32(state0, abcd));
+  vst1q_u32(&digest[4], vaddq_u32(state1, efgh));
+}
+
+static uint8_t cpu_armv8 (void)
+{
+#if defined(__linux__) && defined(HWCAP_SHA2)
+  return (getauxval(AT_HWCAP) & HWCAP_SHA2) ? 1 : 0;
+#else
+  return 1; // built for a target that guarantees it
+#endif
+}
+
+#endif // SHA256_ARMV8
+
+// one padded block of a message into chunk words, bits is the total length including anything already in the state
+static void sha256_block (const uint8_t *msg, size_t len, uint64_t bits, size_t block, uint32_t *chunk)
+{
+  size_t at = block << 6;
+
+  // whole block of message, common case
+  if (at + 64 <= len)
+  {
+    msg += at;
+    for (int j = 0; j < 16; ++j, msg += 4)
+      chunk[j] = ((uint32_t)msg[0] << 24) | ((uint32_t)msg[1] << 16) | ((uint32_t)msg[2] << 8) | msg[3];
+    return;
+  }
+
+  memset (chunk, 0, 64);
+  for (size_t i = 0; i < 64; ++i, ++at)
+  {
+    uint8_t byte;
+    if (at < len) byte = msg[at];
+    else if (at == len) byte = 0x80;
+    else break;
+    chunk[i>>2] |= (uint32_t)byte << ((3-(i&3)) << 3);
+  }
+
+  // length goes in the very last block
+  if (block == ((len + 8) >> 6))
+  {
+    chunk[14] = (uint32_t)(bits >> 32);
+    chunk[15] = (uint32_t)bits;
+  }
+}
+
+// number of padded blocks for a message
+#define SHA256_BLOCKS(len) (((len) + 8 + 64) >> 6)
+
+// a back-end is a compress and the lanes that go with it, only ever swapped as a whole through one pointer
+typedef struct sha256_impl_struct
+{
+  char *name;
+  void (*compress) (uint32_t *digest, uint32_t *chunk);
+  void (*lanes) (const struct sha256_impl_struct *impl, sha256_lane_t *lanes, size_t n);
+} sha256_impl_s;
+
+static const sha256_impl_s *sha256_get (void);
+
+static void sha256_compress (uint32_t *digest, uint32_t *chunk)
+{
+  sha256_get ()->compress (digest, chunk);
+}
+
+static void sha256_lanes_generic (const sha256_impl_s *impl, sha256_lane_t *lanes, size_t n)
+{
+  uint32_t chunk[16];
+  for (size_t l = 0; l < n; ++l)
+  {
+    size_t blocks = SHA256_BLOCKS(lanes[l].len);
+    for (size_t b = 0; b < blocks; ++b)
+    {
+      sha256_block (lanes[l].in, lanes[l].len, lanes[l].bits, b, chunk);
+      impl->compress (lanes[l].state, chunk);
+    }
+  }
+}
+
+#ifdef SHA256_X86
+// transposes up to eight lanes at a time through compress_x8, lanes that run out of blocks keep their state
+__attribute__((target("avx2")))
+static void sha256_lanes_x8 (const sha256_impl_s *impl, sha256_lane_t *lanes, size_t n)
+{
+  uint32_t digest[8][8], chunk[16][8], single[16];
+  size_t blocks[8], max;
+
+  for (; n > 0; lanes += 8, n = (n > 8) ? n - 8 : 0)
+  {
+    size_t count = (n > 8) ? 8 : n;
+    memset (digest, 0, sizeof(digest));
+    memset (chunk, 0, sizeof(chunk));
+    for (size_t l = max = 0; l < count; ++l)
+    {
+      for (int i = 0; i < 8; ++i) digest[i][l] = lanes[l].state[i];
+      blocks[l] = SHA256_BLOCKS(lanes[l].len);
+      if (blocks[l] > max) max = blocks[l];
+    }
+
+    for (size_t b = 0; b < max; ++b)
+    {
+      uint32_t saved[8][8];
+      memcpy (saved, digest, sizeof(saved));
+      for (size_t l = 0; l < count; ++l)
+      {
+        if (b >= blocks[l]) continue;
+        sha256_block (lanes[l].in, lanes[l].len, lanes[l].bits, b, single);
+        for (int j = 0; j < 16; ++j) chunk[j][l] = single[j];
+      }
+      compress_x8 (digest, chunk);
+      for (size_t l = 0; l < count; ++l)
+        if (b >= blocks[l]) for (int i = 0; i < 8; ++i) digest[i][l] = saved[i][l];
+    }
+
+    for (size_t l = 0; l < count; ++l)
+      for (int i = 0; i < 8; ++i) lanes[l].state[i] = digest[i][l];
+  }
+}
+#endif
+
+#if defined(SHA256_X86) || defined(SHA256_ARMV8)
+// checks a candidate compress against the portable one on a couple of chained blocks
+static uint8_t sha256_validate (void (*candidate)(uint32_t *digest, uint32_t *chunk))
+{
+  uint32_t d1[8], d2[8], c1[16], c2[16];
+  memcpy (d1, initial_state, 32);
+  memcpy (d2, initial_state, 32);
+  for (uint32_t round = 0; round < 3; ++round)
+  {
+    for (uint32_t i = 0; i < 16; ++i) c1[i] = c2[i] = (i * 0x9e3779b9) ^ (round * 0x85ebca6b) ^ d1[i&7];
+    compress (d1, c1);
+    candidate (d2, c2);
+  }
+  return memcmp (d1, d2, 32) == 0;
+}
+#endif
+
+static const sha256_impl_s sha256_generic = {"generic", compress, sha256_lanes_generic};
+#ifdef SHA256_X86
+static const sha256_impl_s sha256_shani = {"shani", compress_shani, sha256_lanes_generic};
+static const sha256_impl_s sha256_avx2 = {"avx2", compress, sha256_lanes_x8};
+#endif
+#ifdef SHA256_ARMV8
+static const sha256_impl_s sha256_armv8 = {"armv8", compress_armv8, sha256_lanes_generic};
+#endif
+
+#ifdef SHA256_X86
+static uint8_t sha256_validate_lanes (const sha256_impl_s *candidate)
+{
+  uint8_t msg[200];
+  sha256_lane_t a[10], b[10];
+  for (size_t i = 0; i < sizeof(msg); ++i) msg[i] = (uint8_t)(i * 13 + 1);
+  for (size_t l = 0; l < 10; ++l)
+  {
+    memcpy (a[l].state, initial_state, 32);
+    a[l].in = msg;
+    a[l].len = l * 19;
+    a[l].bits = (uint64_t)a[l].len << 3;
+    b[l] = a[l];
+  }
+  sha256_lanes_generic (&sha256_generic, a, 10);
+  candidate->lanes (candidate, b, 10);
+  for (size_t l = 0; l < 10; ++l) if (memcmp (a[l].state, b[l].state, 32) != 0) return 0;
+  return 1;
+}
+#endif
+
+// the best validated back-end, or a specific one by name, only looks at the cpu so threads racing here agree
+static const sha256_impl_s *sha256_pick (char *name)
+{
+  const sha256_impl_s *pick = &sha256_generic;
+
+  if (name && util_cmp (name, "generic") == 0) return pick;
+#ifdef SHA256_X86
+  uint8_t shani, avx2;
+  sha256_cpu (&shani, &avx2);
+  if (shani && (!name || util_cmp (name, "shani") == 0) && sha256_validate (compress_shani)) pick = &sha256_shani;
+  // one stream on the sha extensions beats eight lanes of avx2, so only batch that way without them
+  else if (avx2 && (!name || util_cmp (name, "avx2") == 0) && sha256_validate_lanes (&sha256_avx2)) pick = &sha256_avx2;
+#endif
+#ifdef SHA256_ARMV8
+  if (cpu_armv8 () && (!name || util_cmp (name, "armv8") == 0) && sha256_validate (compress_armv8)) pick = &sha256_armv8;
+#endif
+  if (name && util_cmp (name, pick->name) != 0) LOG_DEBUG("sha256 back-end %s unavailable, using %s", name, pick->name);
+  return pick;
+}
+
+// picked on first use, whoever gets there first sets it
+static const sha256_impl_s *sha256_impl = NULL;
+static const sha256_impl_s *sha256_get (void)
+{
+  const sha256_impl_s *impl = __atomic_load_n (&sha256_impl, __ATOMIC_ACQUIRE), *none = NULL;
+  if (impl) return impl;
+  impl = sha256_pick (NULL);
+  if (!__atomic_compare_exchange_n (&sha256_impl, &none, impl, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) impl = none;
+  return impl;
+}
+
+// forcing one is safe while other threads hash, they keep the pair they loaded and every back-end gives the same
+// digests, returns the active name
+char *sha256_backend (char *name)
+{
+  const sha256_impl_s *impl;
+  if (!name) return sha256_get ()->name;
+  impl = sha256_pick (name);
+  __atomic_store_n (&sha256_impl, impl, __ATOMIC_RELEASE);
+  return impl->name;
+}
+
 /* TODO: Need to correctly handle the case where len == 2^32-1 */
 void SHA256 (uint8_t *hash, uint8_t const * msg, uint32_t len)
 {
@@ -142,7 +531,7 @@ void SHA256 (uint8_t *hash, uint8_t const * msg, uint32_t len)
       chunk[j] |= ((uint32_t)*(msg++));
     }
     
-    compress (digest, chunk);
+    sha256_compress (digest, chunk);
   }
   
   // Last chunk
@@ -156,13 +545,13 @@ void SHA256 (uint8_t *hash, uint8_t const * msg, uint32_t len)
     
     if ((len & 63) > 55)
     {
-      compress (digest, chunk);
+      sha256_compress (digest, chunk);
       memset (chunk, 0, 64);
     }
     
     chunk[14] = (len >> 29);
     chunk[15] = len << 3;
-    compress (digest, chunk);
+    sha256_compress (digest, chunk);
   }
   
   for (int i = 0; i < 8; ++i)
@@ -175,7 +564,6 @@ void SHA256 (uint8_t *hash, uint8_t const * msg, uint32_t len)
 }
 
 
-static const uint32_t initial_state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
 void SHA256_partial (uint8_t *hash, SHA256_CTX *const state, uint8_t const *src, uint32_t len, bool const first, bool const last)
 {
   // First data
@@ -188,6 +576,18 @@ void SHA256_partial (uint8_t *hash, SHA256_CTX *const state, uint8_t const *src,
   
   while (len > 0)
   {
+    // whole blocks skip the byte-at-a-time buffering
+    if (state->chunk_len == 0 && len >= 64)
+    {
+      sha256_block (src, 64, 0, 0, state->chunk);
+      sha256_compress (state->state, state->chunk);
+      memset (state->chunk, 0, 64);
+      src += 64;
+      len -= 64;
+      state->totallen += 64;
+      continue;
+    }
+
     while ((state->chunk_len < 64) && (len > 0))
     {
       state->chunk[state->chunk_len>>2] |= ((uint32_t)*(src++)) << (8*(3-(state->chunk_len&3)));
@@ -198,7 +598,7 @@ void SHA256_partial (uint8_t *hash, SHA256_CTX *const state, uint8_t const *src,
     
     if (state->chunk_len == 64)
     {
-      compress (state->state, state->chunk);
+      sha256_compress (state->state, state->chunk);
       state->chunk_len = 0;
       memset (state->chunk, 0, 64);
     }
@@ -211,13 +611,13 @@ void SHA256_partial (uint8_t *hash, SHA256_CTX *const state, uint8_t const *src,
     
     if ((state->totallen & 63) > 55)
     {
-      compress (state->state, state->chunk);
+      sha256_compress (state->state, state->chunk);
       memset (state->chunk, 0, 64);
     }
     
     state->chunk[14] = (state->totallen >> 29);
     state->chunk[15] = state->totallen << 3;
-    compress (state->state, state->chunk);
+    sha256_compress (state->state, state->chunk);
     
     for (int i = 0; i < 8; ++i)
     {
@@ -337,6 +737,103 @@ void hmac_256(const unsigned char *key, size_t keylen, const unsigned char *inpu
   sha256_hmac(key, keylen, input, ilen, output, 0);
 }
 
+// one load so the lanes and the compress they use are a matching pair
+static void sha256_lanes_run (sha256_lane_t *lanes, size_t n)
+{
+  const sha256_impl_s *impl = sha256_get ();
+  impl->lanes (impl, lanes, n);
+}
+
+static void sha256_lane_out (sha256_lane_t *lane, uint8_t *hash)
+{
+  for (int i = 0; i < 8; ++i)
+  {
+    *(hash++) = lane->state[i] >> 24;
+    *(hash++) = lane->state[i] >> 16;
+    *(hash++) = lane->state[i] >> 8;
+    *(hash++) = lane->state[i];
+  }
+}
+
+void sha256_multi (const uint8_t *const in[], const size_t ilen[], uint8_t *out[], size_t n)
+{
+  sha256_lane_t lanes[8];
+  while (n > 0)
+  {
+    size_t count = (n > 8) ? 8 : n;
+    for (size_t l = 0; l < count; ++l)
+    {
+      memcpy (lanes[l].state, initial_state, 32);
+      lanes[l].in = in[l];
+      lanes[l].len = ilen[l];
+      lanes[l].bits = (uint64_t)ilen[l] << 3;
+    }
+    sha256_lanes_run (lanes, count);
+    for (size_t l = 0; l < count; ++l) sha256_lane_out (&lanes[l], out[l]);
+    in += count;
+    ilen += count;
+    out += count;
+    n -= count;
+  }
+}
+
+// state after one block of key xor pad
+static void hmac_256_pad (const unsigned char *key, size_t keylen, uint8_t byte, uint32_t *state)
+{
+  uint8_t pad[64], khash[32];
+  uint32_t chunk[16];
+
+  if (keylen > 64)
+  {
+    sha256 (key, keylen, khash, 0);
+    key = khash;
+    keylen = 32;
+  }
+  memset (pad, byte, 64);
+  for (size_t i = 0; i < keylen; i++) pad[i] ^= key[i];
+  memcpy (state, initial_state, 32);
+  sha256_block (pad, 64, 0, 0, chunk);
+  sha256_compress (state, chunk);
+  memset (pad, 0, 64);
+  memset (khash, 0, 32);
+}
+
+void hmac_256_multi (const unsigned char *const key[], const size_t keylen[], const unsigned char *const in[], const size_t ilen[], unsigned char *out[], size_t n)
+{
+  sha256_lane_t inner[8], outer[8];
+  uint8_t ihash[8][32];
+
+  while (n > 0)
+  {
+    size_t count = (n > 8) ? 8 : n;
+    for (size_t l = 0; l < count; ++l)
+    {
+      hmac_256_pad (key[l], keylen[l], 0x36, inner[l].state);
+      inner[l].in = in[l];
+      inner[l].len = ilen[l];
+      inner[l].bits = (uint64_t)(64 + ilen[l]) << 3;
+      hmac_256_pad (key[l], keylen[l], 0x5c, outer[l].state);
+    }
+    sha256_lanes_run (inner, count);
+    for (size_t l = 0; l < count; ++l)
+    {
+      sha256_lane_out (&inner[l], ihash[l]);
+      outer[l].in = ihash[l];
+      outer[l].len = 32;
+      outer[l].bits = (uint64_t)(64 + 32) << 3;
+    }
+    sha256_lanes_run (outer, count);
+    for (size_t l = 0; l < count; ++l) sha256_lane_out (&outer[l], out[l]);
+    key += count;
+    keylen += count;
+    in += count;
+    ilen += count;
+    out += count;
+    n -= count;
+  }
+  memset (ihash, 0, sizeof(ihash));
+}
+
 /*
    Implements the HKDF algorithm (HMAC-based Extract-and-Expand Key
    Derivation Function, RFC 5869).
@@ -181,6 +181,14 @@ static cmpresult_t uECC_vli_cmp_unsafe(const uECC_word_t *left,
     #include "asm_avr.inc"
 #endif
 
+#if (uECC_WORD_SIZE == 8) && SUPPORTS_INT128 && defined(__GNUC__)
+    #if (uECC_PLATFORM == uECC_x86_64)
+        #include "asm_x86_64.inc"
+    #elif (uECC_PLATFORM == uECC_arm64)
+        #include "asm_arm64.inc"
+    #endif
+#endif
+
 #if default_RNG_defined
 static uECC_RNG_Function g_rng_function = &default_RNG;
 #else
@@ -47,8 +47,10 @@ void link_free(link_t link)
     link->x = NULL;
   }
 
-  // notify pipe w/ NULL packet
-  if(link->send_cb) link->send_cb(link, NULL, link->send_arg);
+  // notify pipes w/ NULL packet
+  uint8_t i;
+  for(i = 0; i < link->pipes_len; i++) link->pipes[i].send(link, NULL, link->pipes[i].arg);
+  link->pipes_len = 0;
 
   // go through link->chans
   chan_t c, cnext;
@@ -98,6 +100,12 @@ chan_t link_chan_get(link_t link, uint32_t id)
   return NULL;
 }
 
+lob_t link_stats(link_t link)
+{
+  if(!link) return LOG("bad args");
+  return mesh_stats_json(&link->stats);
+}
+
 // get link info json
 lob_t link_json(link_t link)
 {
@@ -131,11 +139,12 @@ link_t link_get_keys(mesh_t mesh, lob_t keys)
 link_t link_get_key(mesh_t mesh, lob_t key, uint8_t csid)
 {
   link_t link;
+  struct hashname_struct id;
 
   if(!mesh || !key) return LOG("invalid args");
   if(hashname_id(mesh->keys,key) > csid) return LOG("invalid csid");
 
-  link = link_get(mesh, hashname_vkey(key, csid));
+  link = link_get(mesh, hashname_vkey_r(key, csid, &id));
   if(!link) return LOG("invalid key");
 
   // load key if it's not yet
@@ -179,25 +188,194 @@ link_t link_load(link_t link, uint8_t csid, lob_t key)
   link->csid = csid;
   link->key = copy;
 
-  e3x_exchange_out(link->x, util_sys_seconds());
+  e3x_exchange_out(link->x, mesh_seconds(link->mesh));
   LOG("new exchange session to %s",hashname_short(link->id));
 
   return link;
 }
 
+// ms clock for pipe timing, never 0 so that can mean unset
+static uint32_t link_ms(link_t link)
+{
+  uint32_t ms = (uint32_t)mesh_ms(link->mesh);
+  return ms ? ms : 1;
+}
+
+// how long a pipe gets to answer
+static uint32_t pipe_rto(link_pipe_s *pipe)
+{
+  uint32_t rto;
+  if(!pipe->rtt) return LINK_PIPE_TIMEOUT;
+  rto = pipe->rtt + 4 * pipe->rttvar;
+  if(rto < LINK_PIPE_RTO_MIN) return LINK_PIPE_RTO_MIN;
+  if(rto > LINK_PIPE_TIMEOUT) return LINK_PIPE_TIMEOUT;
+  return rto;
+}
+
+// round trip weighted up to 4x by loss, lower is better
+static uint64_t pipe_score(link_pipe_s *pipe)
+{
+  uint64_t rtt = pipe->rtt ? pipe->rtt : LINK_PIPE_TIMEOUT / 2;
+  return rtt + ((rtt * 3 * pipe->loss) >> 16);
+}
+
+link_pipe_s *link_pipe_rtt(link_pipe_s *pipe, uint32_t ms)
+{
+  uint32_t diff;
+  if(!pipe) return NULL;
+  if(!ms) ms = 1;
+
+  // smoothed like tcp does
+  if(!pipe->rtt)
+  {
+    pipe->rtt = ms;
+    pipe->rttvar = ms / 2;
+    return pipe;
+  }
+  diff = (pipe->rtt > ms) ? pipe->rtt - ms : ms - pipe->rtt;
+  pipe->rttvar = (3 * pipe->rttvar + diff) / 4;
+  pipe->rtt = (7 * pipe->rtt + ms) / 8;
+  if(!pipe->rtt) pipe->rtt = 1;
+  return pipe;
+}
+
+link_pipe_s *link_pipe_mtu(link_pipe_s *pipe, uint32_t mtu)
+{
+  if(!pipe) return NULL;
+  if(pipe->mtu != mtu) LOG_DEBUG("pipe mtu %u to %u",pipe->mtu,mtu);
+  pipe->mtu = mtu;
+  return pipe;
+}
+
+uint32_t link_mtu(link_t link)
+{
+  link_pipe_s *pipe;
+  uint32_t overhead;
+  if(!(pipe = link_pipe_best(link)) || !pipe->mtu) return 0;
+  overhead = link->x ? link->x->cs->overhead : 0;
+  return (pipe->mtu > overhead) ? pipe->mtu - overhead : 1;
+}
+
+link_pipe_s *link_pipe_get(link_t link, link_t (*send)(link_t link, lob_t packet, void *arg), void *arg)
+{
+  uint8_t i;
+  if(!link || !send) return NULL;
+  for(i = 0; i < link->pipes_len; i++) if(link->pipes[i].send == send && link->pipes[i].arg == arg) return &link->pipes[i];
+  return NULL;
+}
+
+link_pipe_s *link_pipe_best(link_t link)
+{
+  link_pipe_s *pipe, *best = NULL;
+  uint32_t now;
+  uint8_t i;
+
+  if(!link || !link->pipes_len) return NULL;
+  if(link->pipes_len == 1) return &link->pipes[0];
+
+  now = link_ms(link);
+  for(i = 0; i < link->pipes_len; i++)
+  {
+    pipe = &link->pipes[i];
+
+    // sent to and silent for too long
+    if(pipe->waiting && now - pipe->waiting > pipe_rto(pipe))
+    {
+      if(!pipe->failed) LOG_INFO("pipe %d to %s stopped answering",i,hashname_short(link->id));
+      pipe->failed = 1;
+      pipe->waiting = 0;
+      pipe->loss += (65535 - pipe->loss) >> 3;
+    }
+
+    // working beats failed, then the best score, then whichever was heard from last
+    if(!best) best = pipe;
+    else if(pipe->failed != best->failed){ if(!pipe->failed) best = pipe; }
+    else if(!pipe->failed && pipe_score(pipe) != pipe_score(best)){ if(pipe_score(pipe) < pipe_score(best)) best = pipe; }
+    else if((int32_t)(pipe->heard - best->heard) > 0) best = pipe;
+  }
+
+  return best;
+}
+
+// deliver over this one pipe, the packet is the pipe's if it takes it and still the caller's if not
+static link_t link_send_pipe(link_t link, link_pipe_s *pipe, lob_t outer)
+{
+  size_t len = lob_len(outer);
+  link_t ok;
+  TRACE_START(sent);
+  ok = pipe->send(link, outer, pipe->arg);
+  TRACE_STOP(transport, sent, link);
+  if(!ok)
+  {
+    pipe->failed = 1;
+    return NULL;
+  }
+  if(!pipe->waiting) pipe->waiting = link_ms(link);
+  LINK_STAT(link, packets_out, 1);
+  LINK_STAT(link, bytes_out, len);
+  return ok;
+}
+
 // add a delivery pipe to this link
 link_t link_pipe(link_t link, link_t (*send)(link_t link, lob_t packet, void *arg), void *arg)
 {
+  link_pipe_s *pipe;
+  lob_t handshake;
+  uint32_t now;
+  uint8_t i;
+
   if(!link || !send) return NULL;
+  now = link_ms(link);
 
-  if(send == link->send_cb && arg == link->send_arg) return link; // noop
-  if(link->send_cb) LOG_INFO("replacing existing pipe on link");
+  // already have it, anything heard over it answers the oldest send
+  if((pipe = link_pipe_get(link, send, arg)))
+  {
+    if(pipe->waiting)
+    {
+      link_pipe_rtt(pipe, now - pipe->waiting);
+      pipe->waiting = 0;
+      pipe->loss -= pipe->loss >> 3;
+    }
+    if(pipe->failed) LOG_INFO("pipe to %s is answering again",hashname_short(link->id));
+    pipe->failed = 0;
+    pipe->heard = now;
+    return link;
+  }
 
-  link->send_cb = send;
-  link->send_arg = arg;
+  // full, the one to go is failed or else the longest unheard
+  if(link->pipes_len == LINK_PIPES)
+  {
+    for(pipe = &link->pipes[0], i = 1; i < LINK_PIPES; i++)
+    {
+      if(link->pipes[i].failed != pipe->failed){ if(link->pipes[i].failed) pipe = &link->pipes[i]; }
+      else if((int32_t)(pipe->heard - link->pipes[i].heard) > 0) pipe = &link->pipes[i];
+    }
+    LOG_INFO("replacing a pipe on link %s",hashname_short(link->id));
+    pipe->send(link, NULL, pipe->arg);
+    *pipe = link->pipes[--link->pipes_len];
+  }
 
-  // flush handshake
-  return link_sync(link);
+  pipe = &link->pipes[link->pipes_len++];
+  memset(pipe,0,sizeof(link_pipe_s));
+  pipe->send = send;
+  pipe->arg = arg;
+  pipe->heard = now;
+
+  // flush handshake over it
+  if(!link->x) return LOG("no exchange");
+  if(!(handshake = link_handshake(link))) return LOG("handshake failed");
+  if(link_send_pipe(link, pipe, handshake)) return link;
+  LINK_STAT(link, drop_delivery, 1);
+  lob_free(handshake);
+  return LOG_WARN("handshake failed on new pipe");
+}
+
+link_t link_unpipe(link_t link, link_t (*send)(link_t link, lob_t packet, void *arg), void *arg)
+{
+  link_pipe_s *pipe;
+  if(!(pipe = link_pipe_get(link, send, arg))) return NULL;
+  *pipe = link->pipes[--link->pipes_len];
+  return link;
 }
 
 // is the link ready/available
@@ -225,6 +403,7 @@ link_t link_receive_handshake(link_t link, lob_t inner)
     util_unhex(lob_get(inner, "csid"), 2, &csid);
     if(!link_load(link, csid, inner))
     {
+      LINK_STAT(link, handshakes_bad, 1);
       lob_free(inner);
       return LOG("load key failed for %s %u %s",hashname_short(link->id),csid,util_hex(inner->body,inner->body_len,NULL));
     }
@@ -232,6 +411,7 @@ link_t link_receive_handshake(link_t link, lob_t inner)
 
   if((err = e3x_exchange_verify(link->x,outer)))
   {
+    LINK_STAT(link, handshakes_bad, 1);
     lob_free(inner);
     return LOG("handshake verification fail: %d",err);
   }
@@ -243,6 +423,7 @@ link_t link_receive_handshake(link_t link, lob_t inner)
   // if bad at, always send current handshake
   if(e3x_exchange_in(link->x, at) < out)
   {
+    LINK_STAT(link, handshakes_bad, 1);
     LOG("old handshake: %s (%d,%d,%d)",lob_json(inner),at,out);
     link_sync(link);
     lob_free(inner);
@@ -252,10 +433,13 @@ link_t link_receive_handshake(link_t link, lob_t inner)
   // try to sync ephemeral key
   if(!e3x_exchange_sync(link->x,outer))
   {
+    LINK_STAT(link, handshakes_bad, 1);
     lob_free(inner);
     return LOG("sync failed");
   }
 
+  LINK_STAT(link, handshakes_ok, 1);
+
   // we may need to re-sync
   if(out != e3x_exchange_out(link->x,0)) link_sync(link);
 
@@ -273,13 +457,13 @@ link_t link_receive_handshake(link_t link, lob_t inner)
 
 // forward declare
 chan_t link_process_chan(chan_t c, uint32_t now);
+static link_t link_receive_open(link_t link, lob_t inner);
+
 // process a decrypted channel packet
-link_t link_receive(link_t link, lob_t inner)
+static link_t link_receive_one(link_t link, lob_t inner)
 {
   chan_t c;
 
-  if(!link || !inner) return LOG("bad args");
-
   LOG("<-- %d",lob_get_int(inner,"c"));
   // see if existing channel and send there
   if((c = link_chan_get(link, lob_get_int(inner,"c"))))
@@ -292,15 +476,66 @@ link_t link_receive(link_t link, lob_t inner)
     return link;
   }
 
-  // if it's an open, validate and fire event
+  return link_receive_open(link, inner);
+}
+
+link_t link_receive(link_t link, lob_t inner)
+{
+  TRACE_START(at);
+  if(!link || !inner) return LOG("bad args");
+  link = link_receive_one(link, inner);
+  TRACE_STOP(link_receive, at, link);
+  return link;
+}
+
+// queue a list of decrypted channel packets and process the channels once at the end
+link_t link_receive_batch(link_t link, lob_t inners)
+{
+  chan_t c;
+  lob_t inner;
+  link_t ret = NULL;
+  uint8_t queued = 0;
+  uint32_t count = 0;
+
+  if(!link || !inners) return LOG("bad args");
+  TRACE_START(at);
+
+  while((inner = lob_shift(inners)))
+  {
+    inners = inner->next;
+    inner->next = NULL;
+    count++;
+    LOG("<-- %d",lob_get_int(inner,"c"));
+    if((c = link_chan_get(link, lob_get_int(inner,"c"))))
+    {
+      chan_receive(c, inner);
+      queued = 1;
+      ret = link;
+      continue;
+    }
+    if(link_receive_open(link, inner)) ret = link;
+  }
+
+  // one pass fires each channel's handler w/ everything it got
+  if(queued) link->chans = link_process_chan(link->chans, 0);
+  TRACE_STOP_EACH(link_receive, at, link, count);
+
+  return ret;
+}
+
+// if it's an open, validate and fire event
+static link_t link_receive_open(link_t link, lob_t inner)
+{
   if(!lob_get(inner,"type"))
   {
+    LINK_STAT(link, drop_open, 1);
     LOG("invalid channel open, no type %s",lob_json(inner));
     lob_free(inner);
     return NULL;
   }
   if(!e3x_exchange_cid(link->x, inner))
   {
+    LINK_STAT(link, drop_open, 1);
     LOG("invalid channel open id %s",lob_json(inner));
     lob_free(inner);
     return NULL;
@@ -308,6 +543,7 @@ link_t link_receive(link_t link, lob_t inner)
   inner = mesh_open(link->mesh,link,inner);
   if(inner)
   {
+    LINK_STAT(link, drop_open, 1);
     LOG("unhandled channel open %s",lob_json(inner));
     lob_free(inner);
     return NULL;
@@ -319,20 +555,32 @@ link_t link_receive(link_t link, lob_t inner)
 // deliver this packet
 link_t link_send(link_t link, lob_t outer)
 {
+  link_pipe_s *pipe;
+  uint8_t tries;
+  TRACE_START(at);
   if(!outer) return LOG_INFO("send packet missing");
-  if(!link || !link->send_cb)
+  if(!link || !link->pipes_len)
   {
+    if(link) LINK_STAT(link, drop_network, 1);
     lob_free(outer);
+    TRACE_STOP(link_send, at, link);
     return LOG_WARN("no network");
   }
 
-  if(!link->send_cb(link, outer, link->send_arg))
+  // the pipe owns outer once it's handed over, one that refuses it is skipped for the next best
+  for(tries = 0; tries < link->pipes_len; tries++)
   {
-    lob_free(outer);
-    return LOG_WARN("delivery failed");
+    pipe = link_pipe_best(link);
+    if(tries && pipe->failed) break;
+    if(!link_send_pipe(link, pipe, outer)) continue;
+    TRACE_STOP(link_send, at, link);
+    return link;
   }
 
-  return link;
+  LINK_STAT(link, drop_delivery, 1);
+  lob_free(outer);
+  TRACE_STOP(link_send, at, link);
+  return LOG_WARN("delivery failed");
 }
 
 lob_t link_handshake(link_t link)
@@ -354,14 +602,28 @@ lob_t link_handshake(link_t link)
   return handshake;
 }
 
-// send current handshake
+// send current handshake over every pipe, so failed ones get a chance to answer again
 link_t link_sync(link_t link)
 {
+  link_t ok = NULL;
+  lob_t handshake, copy;
+  uint8_t i;
+
   if(!link) return LOG("bad args");
   if(!link->x) return LOG("no exchange");
-  if(!link->send_cb) return LOG("no network");
+  if(!link->pipes_len) return LOG("no network");
+  if(link->pipes_len == 1) return link_send(link, link_handshake(link));
+
+  if(!(handshake = link_handshake(link))) return LOG("handshake failed");
+  for(i = 0; i < link->pipes_len; i++)
+  {
+    if(!(copy = lob_copy(handshake))) break;
+    if(link_send_pipe(link, &link->pipes[i], copy)) ok = link;
+    else lob_free(copy);
+  }
+  lob_free(handshake);
 
-  return link_send(link, link_handshake(link));
+  return ok;
 }
 
 // trigger a new exchange sync
@@ -390,6 +652,7 @@ chan_t link_chan(link_t link, lob_t open)
   c->link = link;
   c->next = link->chans;
   link->chans = c;
+  LINK_STAT(link, chan_open, 1);
 
   return c;
 }
@@ -398,8 +661,9 @@ chan_t link_chan(link_t link, lob_t open)
 link_t link_direct(link_t link, lob_t inner)
 {
   if(!link || !inner) return LOG("bad args");
-  if(!link->send_cb)
+  if(!link->pipes_len)
   {
+    LINK_STAT(link, drop_network, 1);
     LOG_WARN("no network, dropping %s",lob_json(inner));
     return NULL;
   }
@@ -436,13 +700,10 @@ link_t link_down(link_t link)
     chan_process(c, 0);
   }
 
-  // remove pipe
-  if(link->send_cb)
-  {
-    link->send_cb(link, NULL, link->send_arg); // notify jic
-    link->send_cb = NULL;
-    link->send_arg = NULL;
-  }
+  // remove pipes
+  uint8_t i;
+  for(i = 0; i < link->pipes_len; i++) link->pipes[i].send(link, NULL, link->pipes[i].arg); // notify jic
+  link->pipes_len = 0;
 
   return NULL;
 }
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include "telehash.h"
 
 // internally handle list of triggers active on the mesh
@@ -75,7 +76,8 @@ uint8_t mesh_load(mesh_t mesh, lob_t secrets, lob_t keys)
   if(!mesh || !secrets || !keys) return 1;
   if(!(mesh->self = e3x_self_new(secrets, keys))) return 2;
   mesh->keys = lob_copy(keys);
-  mesh->id = hashname_dup(hashname_vkeys(mesh->keys));
+  struct hashname_struct id;
+  mesh->id = hashname_dup(hashname_vkeys_r(mesh->keys, &id));
   LOG_INFO("mesh is %s",hashname_short(mesh->id));
   return 0;
 }
@@ -132,6 +134,51 @@ lob_t mesh_links(mesh_t mesh)
   return links;
 }
 
+lob_t mesh_stats_json(struct mesh_stats_struct *stats)
+{
+  lob_t json;
+  char num[21];
+  int len;
+  if(!stats || !(json = lob_new())) return LOG("bad args");
+
+  // each counter may be moving under us, so they're only consistent individually
+#define MESH_STATS_SET(name) \
+  len = snprintf(num, sizeof(num), "%" PRIu64, __atomic_load_n(&stats->name, __ATOMIC_RELAXED)); \
+  lob_set_raw(json, #name, 0, num, (size_t)len);
+  MESH_STATS(MESH_STATS_SET)
+#undef MESH_STATS_SET
+
+  return json;
+}
+
+mesh_t mesh_clock(mesh_t mesh, uint64_t (*clock)(void *arg), void *arg)
+{
+  if(!mesh) return LOG("bad args");
+  mesh->clock = clock;
+  mesh->clock_arg = clock ? arg : NULL;
+  return mesh;
+}
+
+uint64_t mesh_ms(mesh_t mesh)
+{
+  uint64_t ms;
+  if(mesh && mesh->clock) ms = mesh->clock(mesh->clock_arg);
+  else ms = util_sys_ns() / 1000000;
+  return ms ? ms : 1;
+}
+
+uint32_t mesh_seconds(mesh_t mesh)
+{
+  if(mesh && mesh->clock) return (uint32_t)(mesh->clock(mesh->clock_arg) / 1000);
+  return util_sys_seconds();
+}
+
+lob_t mesh_stats(mesh_t mesh)
+{
+  if(!mesh) return LOG("bad args");
+  return mesh_stats_json(&mesh->stats);
+}
+
 // process any channel timeouts based on the current/given time
 mesh_t mesh_process(mesh_t mesh, uint32_t now)
 {
@@ -151,10 +198,11 @@ link_t mesh_add(mesh_t mesh, lob_t json)
   link_t link;
   lob_t keys, paths;
   uint8_t csid;
+  struct hashname_struct id;
 
   if(!mesh || !json) return LOG("bad args");
   LOG("mesh add %s",lob_json(json));
-  link = link_get(mesh, hashname_vchar(lob_get(json,"hashname")));
+  link = link_get(mesh, hashname_vchar_r(lob_get(json,"hashname"), &id));
   keys = lob_get_json(json,"keys");
   paths = lob_get_array(json,"paths");
   if(!link) link = link_get_keys(mesh, keys);
@@ -286,6 +334,7 @@ link_t mesh_receive_handshake(mesh_t mesh, lob_t handshake)
 {
   uint32_t now;
   hashname_t from = NULL;
+  struct hashname_struct fromhn;
   link_t link;
 
   if(!mesh || !handshake) return LOG("bad args");
@@ -295,7 +344,7 @@ link_t mesh_receive_handshake(mesh_t mesh, lob_t handshake)
     lob_free(handshake);
     return NULL;
   }
-  now = util_sys_seconds();
+  now = mesh_seconds(mesh);
   
   // normalize handshake
   handshake->id = now; // save when we cached it
@@ -317,6 +366,7 @@ link_t mesh_receive_handshake(mesh_t mesh, lob_t handshake)
     }
     if(!csid)
     {
+      MESH_STAT(mesh, handshakes_bad, 1);
       LOG("bad link handshake, no csid: %s",lob_json(handshake));
       lob_free(handshake);
       return NULL;
@@ -326,9 +376,10 @@ link_t mesh_receive_handshake(mesh_t mesh, lob_t handshake)
       
     // get attached hashname
     lob_t tmp = lob_parse(handshake->body, handshake->body_len);
-    from = hashname_vkey(tmp, csid);
+    from = hashname_vkey_r(tmp, csid, &fromhn);
     if(!from)
     {
+      MESH_STAT(mesh, handshakes_bad, 1);
       LOG("bad link handshake, no hashname: %s",lob_json(handshake));
       lob_free(tmp);
       lob_free(handshake);
@@ -341,7 +392,7 @@ link_t mesh_receive_handshake(mesh_t mesh, lob_t handshake)
     lob_free(tmp);
 
     // short-cut, if it's a key from an existing link, pass it on
-    // TODO: using mesh_linked here is a stack issue during loopback peer test!
+    // from is on our stack so handshakes nested below can't clobber it
     if((link = mesh_linkid(mesh,from))) return link_receive_handshake(link, handshake);
     LOG("no link found for handshake from %s",hashname_char(from));
 
@@ -358,25 +409,37 @@ link_t mesh_receive_handshake(mesh_t mesh, lob_t handshake)
   return from == NULL ? NULL : mesh_linkid(mesh, from);
 }
 
+// find the link for a channel packet's routing token
+static link_t mesh_token(mesh_t mesh, lob_t outer)
+{
+  link_t link;
+  for(link = mesh->links;link;link = link->next) if(link->x && memcmp(link->x->token,outer->body,8) == 0) break;
+  return link;
+}
+
 // processes incoming packet, it will take ownership of outer
-link_t mesh_receive(mesh_t mesh, lob_t outer)
+static link_t mesh_receive_one(mesh_t mesh, lob_t outer)
 {
   lob_t inner = NULL;
   link_t link = NULL;
   char token[17] = {0};
   hashname_t id;
+  struct hashname_struct idhn;
 
   if(!mesh || !outer) return LOG("bad args");
+  MESH_STAT(mesh, packets_in, 1);
+  MESH_STAT(mesh, bytes_in, lob_len(outer));
   
   LOG("mesh receiving %s to %s",outer->head_len?"handshake":"channel",hashname_short(mesh->id));
 
   // redirect modern routed packets
   if(outer->head_len == 5)
   {
-    id = hashname_sbin(outer->head);
+    id = hashname_sbin_r(outer->head, &idhn);
     link = mesh_linkid(mesh, id);
     if(!link)
     {
+      MESH_STAT(mesh, drop_route, 1);
       LOG_WARN("unknown id for route request: %s",hashname_short(id));
       lob_free(outer);
       return NULL;
@@ -395,6 +458,7 @@ link_t mesh_receive(mesh_t mesh, lob_t outer)
     inner = e3x_self_decrypt(mesh->self, outer);
     if(!inner)
     {
+      MESH_STAT(mesh, handshakes_bad, 1);
       LOG_WARN("%02x handshake failed %s",outer->head[0],e3x_err());
       lob_free(outer);
       return NULL;
@@ -416,23 +480,29 @@ link_t mesh_receive(mesh_t mesh, lob_t outer)
   {
     if(outer->body_len < 16)
     {
+      MESH_STAT(mesh, drop_short, 1);
       LOG("packet too small %d",outer->body_len);
       lob_free(outer);
       return NULL;
     }
 
-    for(link = mesh->links;link;link = link->next) if(link->x && memcmp(link->x->token,outer->body,8) == 0) break;
-
-    if(!link)
+    if(!(link = mesh_token(mesh, outer)))
     {
-      LOG("no link found for token %s",util_hex(outer->body,8,NULL));
+      MESH_STAT(mesh, drop_token, 1);
+      LOG("no link found for token %s",util_hex(outer->body,8,token));
       lob_free(outer);
       return NULL;
     }
     
+    MESH_STAT(link, packets_in, 1);
+    MESH_STAT(link, bytes_in, lob_len(outer));
     inner = e3x_exchange_receive(link->x, outer);
     lob_free(outer);
-    if(!inner) return LOG("channel decryption fail for link %s %s",hashname_short(link->id),e3x_err());
+    if(!inner)
+    {
+      LINK_STAT(link, decrypt_fail, 1);
+      return LOG("channel decryption fail for link %s %s",hashname_short(link->id),e3x_err());
+    }
     
     LOG("channel packet %d bytes from %s",lob_len(inner),hashname_short(link->id));
     return link_receive(link,inner);
@@ -442,7 +512,7 @@ link_t mesh_receive(mesh_t mesh, lob_t outer)
   // transform incoming bare link json format into handshake for discovery
   if((inner = lob_get_json(outer,"keys")))
   {
-    if((id = hashname_vkeys(inner)))
+    if((id = hashname_vkeys_r(inner, &idhn)))
     {
       lob_set(outer,"hashname",hashname_char(id));
       lob_set_int(outer,"at",0);
@@ -459,3 +529,120 @@ link_t mesh_receive(mesh_t mesh, lob_t outer)
 
   return link;
 }
+
+link_t mesh_receive(mesh_t mesh, lob_t outer)
+{
+  link_t link;
+  TRACE_START(at);
+  link = mesh_receive_one(mesh, outer);
+  TRACE_STOP(mesh_receive, at, mesh);
+  return link;
+}
+
+// channel packets pending for one link during a batch
+#define MESH_BATCH_LINKS 8
+typedef struct mesh_batch_struct
+{
+  link_t link;
+  lob_t outers;
+} mesh_batch_t;
+
+// decrypt and deliver everything pending for one link
+static link_t mesh_batch_flush(mesh_t mesh, mesh_batch_t *group)
+{
+  lob_t inners, outer;
+  link_t link, ret;
+  uint64_t count = 0, bytes = 0, failed;
+  TRACE_START(at);
+
+  for(outer = group->outers;outer;outer = lob_next(outer))
+  {
+    count++;
+    bytes += lob_len(outer);
+  }
+
+  // handlers run by an earlier group may have freed this one's link, so look it up again
+  if(!(link = mesh_token(mesh, group->outers)))
+  {
+    MESH_STAT(mesh, drop_token, count);
+    lob_freeall(group->outers);
+    group->link = NULL;
+    group->outers = NULL;
+    return LOG("link went away during a batch, dropping %u packets",(unsigned)count);
+  }
+
+  // the mesh counted these on arrival, the link counts them now that they're known to be its
+  MESH_STAT(link, packets_in, count);
+  MESH_STAT(link, bytes_in, bytes);
+
+  inners = e3x_exchange_receive_batch(link->x, group->outers);
+  for(failed = count, outer = inners;outer;outer = lob_next(outer)) failed--;
+  if(failed) LINK_STAT(link, decrypt_fail, failed);
+  lob_freeall(group->outers);
+  group->link = NULL;
+  group->outers = NULL;
+  if(!inners)
+  {
+    TRACE_STOP_EACH(mesh_receive, at, mesh, (uint32_t)count);
+    return LOG("channel decryption fail for link %s %s",hashname_short(link->id),e3x_err());
+  }
+
+  LOG("channel batch from %s",hashname_short(link->id));
+  ret = link_receive_batch(link, inners);
+  TRACE_STOP_EACH(mesh_receive, at, mesh, (uint32_t)count);
+  return ret;
+}
+
+link_t mesh_receive_batch(mesh_t mesh, lob_t *packets, size_t count)
+{
+  mesh_batch_t groups[MESH_BATCH_LINKS];
+  link_t link, ret = NULL;
+  lob_t outer;
+  size_t i;
+  uint8_t g, used = 0;
+
+  if(!mesh || !packets) return LOG("bad args");
+  memset(groups,0,sizeof(groups));
+
+  for(i=0;i<count;i++)
+  {
+    if(!(outer = packets[i])) continue;
+    packets[i] = NULL;
+
+    // anything but a well-formed channel packet keeps its place in line
+    if(outer->head_len != 0 || outer->body_len < 16 || !(link = mesh_token(mesh, outer)))
+    {
+      for(g=0;g<used;g++) if((link = mesh_batch_flush(mesh, &groups[g]))) ret = link;
+      used = 0;
+      if((link = mesh_receive(mesh, outer))) ret = link;
+      continue;
+    }
+
+    MESH_STAT(mesh, packets_in, 1);
+    MESH_STAT(mesh, bytes_in, lob_len(outer));
+    for(g=0;g<used && groups[g].link != link;g++);
+    if(g == MESH_BATCH_LINKS)
+    {
+      // out of slots, drain them all and start over
+      for(g=0;g<used;g++) if((link = mesh_batch_flush(mesh, &groups[g]))) ret = link;
+      used = 0;
+      g = 0;
+      if(!(link = mesh_token(mesh, outer)))
+      {
+        MESH_STAT(mesh, drop_token, 1);
+        lob_free(outer);
+        continue;
+      }
+    }
+    if(g == used)
+    {
+      groups[g].link = link;
+      used++;
+    }
+    groups[g].outers = lob_push(groups[g].outers, outer);
+  }
+
+  for(g=0;g<used;g++) if((link = mesh_batch_flush(mesh, &groups[g]))) ret = link;
+
+  return ret;
+}
@@ -4,15 +4,49 @@
 link_t pair_send(link_t link, lob_t packet, void *arg)
 {
   net_loopback_t pair = (net_loopback_t)arg;
-  if(!pair || !packet || !link) return link;
+  if(!pair || !link) return link;
+
+  // pipe going away
+  if(!packet)
+  {
+    if(pair->ab == link) pair->ab = NULL;
+    if(pair->ba == link) pair->ba = NULL;
+    return link;
+  }
   LOG("pair pipe from %s",hashname_short(link->id));
-  if(link->mesh == pair->a) mesh_receive(pair->b,packet);
-  else if(link->mesh == pair->b) mesh_receive(pair->a,packet);
-  else lob_free(packet);
+  if(link->mesh != pair->a && link->mesh != pair->b)
+  {
+    lob_free(packet);
+    return link;
+  }
+
+  if(!pair->queued)
+  {
+    link_t to = mesh_receive((link->mesh == pair->a) ? pair->b : pair->a, packet);
+    if(to) link_pipe(to,pair_send,pair); // tells it the pipe is working
+    return link;
+  }
+
+  // append to the other side's fifo
+  packet->next = NULL;
+  if(link->mesh == pair->a)
+  {
+    packet->prev = pair->to_b_end;
+    if(pair->to_b_end) pair->to_b_end->next = packet;
+    else pair->to_b = packet;
+    pair->to_b_end = packet;
+    pair->to_b_len++;
+  }else{
+    packet->prev = pair->to_a_end;
+    if(pair->to_a_end) pair->to_a_end->next = packet;
+    else pair->to_a = packet;
+    pair->to_a_end = packet;
+    pair->to_a_len++;
+  }
   return link;
 }
 
-net_loopback_t net_loopback_new(mesh_t a, mesh_t b)
+static net_loopback_t pair_new(mesh_t a, mesh_t b, uint8_t queued)
 {
   net_loopback_t pair;
 
@@ -20,16 +54,90 @@ net_loopback_t net_loopback_new(mesh_t a, mesh_t b)
   memset(pair,0,sizeof (struct net_loopback_struct));
   pair->a = a;
   pair->b = b;
+  pair->queued = queued;
 
   // ensure they're linked and piped together
-  link_pipe(link_get_keys(a,b->keys),pair_send,pair);
-  link_pipe(link_get_keys(b,a->keys),pair_send,pair);
+  pair->ab = link_get_keys(a,b->keys);
+  link_pipe(pair->ab,pair_send,pair);
+  pair->ba = link_get_keys(b,a->keys);
+  link_pipe(pair->ba,pair_send,pair);
 
   return pair;
 }
 
+net_loopback_t net_loopback_new(mesh_t a, mesh_t b)
+{
+  return pair_new(a, b, 0);
+}
+
+net_loopback_t net_loopback_queued(mesh_t a, mesh_t b)
+{
+  return pair_new(a, b, 1);
+}
+
+// takes up to max off the front of one fifo and delivers them together
+static uint32_t pair_deliver(net_loopback_t pair, mesh_t to, lob_t *head, lob_t *end, uint32_t *len, uint32_t max)
+{
+  lob_t packets[NET_LOOPBACK_BATCH];
+  uint32_t count = 0;
+  link_t link = NULL;
+
+  if(max > NET_LOOPBACK_BATCH) max = NET_LOOPBACK_BATCH;
+  while(count < max && *head)
+  {
+    packets[count] = *head;
+    *head = packets[count]->next;
+    packets[count]->next = packets[count]->prev = NULL;
+    count++;
+  }
+  if(*head) (*head)->prev = NULL;
+  else *end = NULL;
+  *len -= count;
+
+  if(count == 1) link = mesh_receive(to, packets[0]);
+  else if(count) link = mesh_receive_batch(to, packets, count);
+  if(link) link_pipe(link,pair_send,pair);
+  return count;
+}
+
+uint32_t net_loopback_process(net_loopback_t pair, uint32_t batch)
+{
+  uint32_t count = 0, left_a, left_b, done;
+
+  if(!pair) return 0;
+
+  // only what was queued at the start counts against the batch
+  left_a = batch ? batch : pair->to_a_len;
+  left_b = batch ? batch : pair->to_b_len;
+  while(left_a || left_b)
+  {
+    done = pair_deliver(pair, pair->b, &pair->to_b, &pair->to_b_end, &pair->to_b_len, left_b);
+    left_b -= done;
+    count += done;
+    done = pair_deliver(pair, pair->a, &pair->to_a, &pair->to_a_end, &pair->to_a_len, left_a);
+    left_a -= done;
+    count += done;
+
+    if(!batch && !left_a && !left_b)
+    {
+      // and then whatever that sent
+      left_a = pair->to_a_len;
+      left_b = pair->to_b_len;
+    }
+    if(!pair->to_a) left_a = 0;
+    if(!pair->to_b) left_b = 0;
+  }
+
+  return count;
+}
+
 void net_loopback_free(net_loopback_t pair)
 {
+  if(!pair) return;
+  if(pair->ab) link_unpipe(pair->ab,pair_send,pair);
+  if(pair->ba) link_unpipe(pair->ba,pair_send,pair);
+  lob_freeall(pair->to_a);
+  lob_freeall(pair->to_b);
   free(pair);
   return;
 }
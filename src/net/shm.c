@@ -0,0 +1,306 @@
+#if !defined(_WIN32) && (defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__)))
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+#include "net_shm.h"
+
+#define SHM_MAGIC 0x48534854 // "THSH"
+#define SHM_WRAP 0xFFFFFFFF // rest of the ring is unused, carry on from the start
+#define SHM_ALIGN(len) (((len) + 7) & ~(uint64_t)7)
+
+// one direction, positions run free and are masked into the data, each side only writes its own cache line
+typedef struct shm_ring_struct
+{
+  uint64_t tail; // written by the producer
+  uint8_t pad1[56];
+  uint64_t head; // written by the consumer
+  uint32_t waiting; // consumer is about to sleep
+  uint32_t signal; // futex word bumped to wake it
+  uint8_t pad2[48];
+} shm_ring_s;
+
+// the mapped region, followed by each ring's data
+typedef struct shm_region_struct
+{
+  uint32_t magic;
+  uint32_t size; // data bytes in each ring
+  uint32_t attached;
+  uint8_t pad[52];
+  shm_ring_s rings[2];
+} shm_region_s;
+
+struct net_shm_struct
+{
+  mesh_t mesh;
+  link_t link;
+  shm_region_s *region;
+  size_t len;
+  shm_ring_s *in, *out;
+  uint8_t *in_data, *out_data;
+  uint64_t mask;
+  char name[64];
+  int fd;
+  uint8_t creator;
+};
+
+// only a syscall when the consumer said it's asleep
+static void shm_wake(shm_ring_s *ring)
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if(!__atomic_load_n(&ring->waiting, __ATOMIC_RELAXED)) return;
+  __atomic_fetch_add(&ring->signal, 1, __ATOMIC_RELEASE);
+#ifdef __linux__
+  syscall(SYS_futex, &ring->signal, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+}
+
+static uint8_t shm_empty(shm_ring_s *ring)
+{
+  return __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == ring->head;
+}
+
+link_t shm_send(link_t link, lob_t packet, void *arg)
+{
+  net_shm_t net = (net_shm_t)arg;
+  uint64_t head, tail, at, need, skip, size;
+  size_t len;
+
+  if(!net || !link) return NULL;
+
+  // pipe going away
+  if(!packet)
+  {
+    if(net->link == link) net->link = NULL;
+    return link;
+  }
+
+  size = net->mask + 1;
+  len = lob_len(packet);
+  need = 8 + SHM_ALIGN(len);
+  tail = net->out->tail;
+  head = __atomic_load_n(&net->out->head, __ATOMIC_ACQUIRE);
+  at = tail & net->mask;
+  skip = (size - at < need) ? size - at : 0;
+  if(need + skip > size - (tail - head)) return LOG_WARN("ring full, dropping %lu bytes to %s",(unsigned long)len,hashname_short(link->id)); // link_send frees it
+
+  if(skip)
+  {
+    *(uint32_t*)(net->out_data + at) = SHM_WRAP;
+    tail += skip;
+    at = 0;
+  }
+  *(uint32_t*)(net->out_data + at) = (uint32_t)len;
+  memcpy(net->out_data + at + 8, lob_raw(packet), len);
+  __atomic_store_n(&net->out->tail, tail + need, __ATOMIC_RELEASE);
+  lob_free(packet);
+
+  shm_wake(net->out);
+  return link;
+}
+
+net_shm_t net_shm_new(mesh_t mesh, lob_t options)
+{
+  net_shm_t net;
+  shm_region_s *region;
+  struct stat st;
+  char *name;
+  uint32_t size, want;
+  size_t len;
+  uint8_t creator = 1;
+  int fd;
+
+  name = lob_get(options,"name");
+  if(!mesh || !name || name[0] != '/' || strlen(name) >= sizeof(net->name)) return LOG_WARN("bad args");
+  want = lob_get_uint(options,"size");
+  if(!want) want = NET_SHM_SIZE;
+  for(size = 4096; size < want && size < 0x40000000; size <<= 1);
+  len = sizeof(shm_region_s) + (size_t)size * 2;
+
+  // create it or attach to the other side's
+  if((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)) >= 0)
+  {
+    if(ftruncate(fd, len) < 0)
+    {
+      LOG_ERROR("ftruncate failed %s",strerror(errno));
+      close(fd);
+      shm_unlink(name);
+      return NULL;
+    }
+  }else{
+    if(errno != EEXIST || (fd = shm_open(name, O_RDWR, 0600)) < 0) return LOG_ERROR("shm_open %s failed %s",name,strerror(errno));
+    creator = 0;
+    if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(shm_region_s))
+    {
+      close(fd);
+      return LOG_WARN("%s isn't ready",name);
+    }
+    len = (size_t)st.st_size;
+  }
+
+  if((region = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    LOG_ERROR("mmap failed %s",strerror(errno));
+    close(fd);
+    if(creator) shm_unlink(name);
+    return NULL;
+  }
+
+  if(creator)
+  {
+    // ftruncate zeroed it, publishing the magic last means it's ready
+    region->size = size;
+    __atomic_store_n(&region->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+  }else{
+    uint32_t attached = 0;
+    if(__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC || len != sizeof(shm_region_s) + (size_t)region->size * 2)
+    {
+      munmap(region, len);
+      close(fd);
+      return LOG_WARN("%s isn't ready",name);
+    }
+    if(!__atomic_compare_exchange_n(&region->attached, &attached, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      munmap(region, len);
+      close(fd);
+      return LOG_WARN("%s already has both sides",name);
+    }
+    size = region->size;
+  }
+
+  if(!(net = malloc(sizeof (struct net_shm_struct))))
+  {
+    munmap(region, len);
+    close(fd);
+    if(creator) shm_unlink(name);
+    return LOG_ERROR("OOM");
+  }
+  memset(net,0,sizeof (struct net_shm_struct));
+  net->mesh = mesh;
+  net->region = region;
+  net->len = len;
+  net->fd = fd;
+  net->creator = creator;
+  net->mask = size - 1;
+  strcpy(net->name, name);
+
+  // the creator writes the first ring and reads the second
+  net->out = &region->rings[creator ? 0 : 1];
+  net->in = &region->rings[creator ? 1 : 0];
+  net->out_data = (uint8_t*)(region + 1) + (creator ? 0 : size);
+  net->in_data = (uint8_t*)(region + 1) + (creator ? size : 0);
+  LOG_DEBUG("%s %s with %u byte rings",creator?"created":"attached to",name,size);
+
+  return net;
+}
+
+net_shm_t net_shm_free(net_shm_t net)
+{
+  if(!net) return NULL;
+  LOG_DEBUG("closing shm transport %s",net->name);
+
+  // don't leave the link pointing at us
+  if(net->link) link_unpipe(net->link, shm_send, net);
+  munmap(net->region, net->len);
+  close(net->fd);
+  if(net->creator) shm_unlink(net->name);
+  free(net);
+  return NULL;
+}
+
+link_t net_shm_link(net_shm_t net, link_t link)
+{
+  if(!net || !link) return LOG_WARN("bad args");
+  net->link = link;
+  if(!link_pipe(link,shm_send,net)) return NULL;
+
+  // a quarter of the ring, so a packet that size never waits for more than a few ahead of it
+  link_pipe_mtu(link_pipe_get(link,shm_send,net), (uint32_t)((net->mask + 1) / 4));
+  return link;
+}
+
+net_shm_t net_shm_process(net_shm_t net)
+{
+  lob_t packets[NET_SHM_BATCH];
+  uint64_t head, tail, at;
+  uint32_t len;
+  size_t count;
+  link_t link;
+
+  if(!net) return LOG_WARN("bad args");
+
+  do {
+    // copy out a batch and free up the space before the mesh sees any of it
+    head = net->in->head;
+    tail = __atomic_load_n(&net->in->tail, __ATOMIC_ACQUIRE);
+    if(tail - head > net->mask + 1)
+    {
+      LOG_WARN("resetting ring from %s, tail is %lu past head",net->name,(unsigned long)(tail - head));
+      head = tail;
+    }
+    for(count = 0; count < NET_SHM_BATCH && head != tail;)
+    {
+      at = head & net->mask;
+      len = *(uint32_t*)(net->in_data + at);
+      // the other side wrote the length, one running off the ring or past what's been published can't be trusted
+      // and nothing after it can be found either, so drop the rest
+      if(len == SHM_WRAP ? net->mask + 1 - at > tail - head
+        : (8 + (uint64_t)len > net->mask + 1 - at || 8 + SHM_ALIGN(len) > tail - head))
+      {
+        LOG_WARN("resetting ring from %s, bad length %u at %lu",net->name,len,(unsigned long)at);
+        head = tail;
+        break;
+      }
+      if(len == SHM_WRAP)
+      {
+        head += net->mask + 1 - at;
+        continue;
+      }
+      if(!(packets[count] = lob_parse(net->in_data + at + 8, len))) LOG_WARN("dropping unparseable %u bytes",len);
+      else count++;
+      head += 8 + SHM_ALIGN(len);
+    }
+    __atomic_store_n(&net->in->head, head, __ATOMIC_RELEASE);
+    if(!count) break;
+
+    if(!(link = mesh_receive_batch(net->mesh, packets, count))) continue;
+    if(link != net->link) LOG_DEBUG("adding new link to shm pipe for %s",hashname_short(link->id));
+    net_shm_link(net, link); // also tells the link the pipe is working
+  } while(count == NET_SHM_BATCH);
+
+  return net;
+}
+
+net_shm_t net_shm_wait(net_shm_t net, uint32_t ms)
+{
+  if(!net) return LOG_WARN("bad args");
+  if(!shm_empty(net->in)) return net;
+
+#ifdef __linux__
+  struct timespec ts;
+  uint32_t signal = __atomic_load_n(&net->in->signal, __ATOMIC_ACQUIRE);
+  __atomic_store_n(&net->in->waiting, 1, __ATOMIC_SEQ_CST);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if(shm_empty(net->in))
+  {
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000;
+    syscall(SYS_futex, &net->in->signal, FUTEX_WAIT, signal, &ts, NULL, 0);
+  }
+  __atomic_store_n(&net->in->waiting, 0, __ATOMIC_RELAXED);
+#else
+  while(ms-- && shm_empty(net->in)) usleep(1000);
+#endif
+
+  return shm_empty(net->in) ? NULL : net;
+}
+
+#endif // POSIX
@@ -0,0 +1,356 @@
+#include <string.h>
+#include "net_sim.h"
+
+// one direction between two meshes, the link's pipe argument
+typedef struct net_sim_pipe_struct
+{
+  net_sim_t sim;
+  mesh_t to; // NULL once either end's mesh is freed
+  link_t link; // the one sending over it, until it lets go
+  net_sim_path_s path;
+  uint64_t busy; // when the last packet queued on it has finished going out
+  struct net_sim_pipe_struct *back; // the other direction
+} *net_sim_pipe_t;
+
+// a packet on its way, ordered by when it arrives and then by when it was sent
+typedef struct net_sim_event_struct
+{
+  uint64_t at;
+  uint64_t seq;
+  net_sim_pipe_t pipe;
+  lob_t packet;
+} net_sim_event_s;
+
+struct net_sim_struct
+{
+  uint64_t now, seq, rand;
+  uint64_t sent, delivered, dropped;
+  net_sim_event_s *events; // min-heap
+  uint32_t count, size;
+  net_sim_pipe_t *pipes;
+  uint32_t pipes_len;
+  mesh_t *meshes;
+  uint32_t meshes_len;
+  uint32_t second; // last virtual second the meshes were processed at
+};
+
+// xorshift64*, only needs to be repeatable
+static uint64_t sim_rand(net_sim_t sim)
+{
+  sim->rand ^= sim->rand >> 12;
+  sim->rand ^= sim->rand << 25;
+  sim->rand ^= sim->rand >> 27;
+  return sim->rand * 0x2545F4914F6CDD1DULL;
+}
+
+// true with the given parts per million
+static uint8_t sim_chance(net_sim_t sim, uint32_t ppm)
+{
+  if(!ppm) return 0;
+  return (sim_rand(sim) >> 32) % 1000000 < ppm;
+}
+
+static uint8_t sim_before(net_sim_event_s *a, net_sim_event_s *b)
+{
+  if(a->at != b->at) return a->at < b->at;
+  return a->seq < b->seq;
+}
+
+static net_sim_t sim_push(net_sim_t sim, uint64_t at, net_sim_pipe_t pipe, lob_t packet)
+{
+  net_sim_event_s event, *events;
+  uint32_t i, up;
+
+  if(sim->count == sim->size)
+  {
+    if(!(events = realloc(sim->events, (sim->size ? sim->size * 2 : 64) * sizeof(net_sim_event_s)))) return LOG("OOM");
+    sim->events = events;
+    sim->size = sim->size ? sim->size * 2 : 64;
+  }
+
+  event.at = at;
+  event.seq = sim->seq++;
+  event.pipe = pipe;
+  event.packet = packet;
+
+  // sift up
+  for(i = sim->count++; i; i = up)
+  {
+    up = (i - 1) / 2;
+    if(!sim_before(&event, &sim->events[up])) break;
+    sim->events[i] = sim->events[up];
+  }
+  sim->events[i] = event;
+  return sim;
+}
+
+// puts the event in the hole at i and moves it down to where it belongs
+static void sim_down(net_sim_t sim, uint32_t i, net_sim_event_s event)
+{
+  uint32_t down;
+  for(; (down = i * 2 + 1) < sim->count; i = down)
+  {
+    if(down + 1 < sim->count && sim_before(&sim->events[down + 1], &sim->events[down])) down++;
+    if(!sim_before(&sim->events[down], &event)) break;
+    sim->events[i] = sim->events[down];
+  }
+  sim->events[i] = event;
+}
+
+static net_sim_event_s sim_pop(net_sim_t sim)
+{
+  net_sim_event_s first = sim->events[0];
+  sim->count--;
+  if(sim->count) sim_down(sim, 0, sim->events[sim->count]);
+  return first;
+}
+
+// never delivers directly, everything waits its turn in the queue
+static link_t sim_send(link_t link, lob_t packet, void *arg)
+{
+  net_sim_pipe_t pipe = (net_sim_pipe_t)arg;
+  net_sim_t sim;
+  uint64_t at;
+
+  if(!pipe || !link) return link;
+
+  // pipe going away
+  if(!packet)
+  {
+    if(pipe->link == link) pipe->link = NULL;
+    return link;
+  }
+  sim = pipe->sim;
+  sim->sent++;
+
+  // nobody on the other end anymore
+  if(!pipe->to)
+  {
+    sim->dropped++;
+    lob_free(packet);
+    return link;
+  }
+
+  // it has to get on the wire before anything else
+  at = (pipe->busy > sim->now) ? pipe->busy : sim->now;
+  if(pipe->path.bandwidth) at += ((uint64_t)lob_len(packet) * 1000000) / pipe->path.bandwidth;
+  pipe->busy = at;
+
+  if(sim_chance(sim, pipe->path.loss))
+  {
+    sim->dropped++;
+    lob_free(packet);
+    return link;
+  }
+
+  at += pipe->path.latency;
+  if(pipe->path.jitter) at += sim_rand(sim) % ((uint64_t)pipe->path.jitter + 1);
+  if(sim_chance(sim, pipe->path.reorder)) at += pipe->path.latency ? pipe->path.latency : 1;
+
+  if(!sim_push(sim, at, pipe, packet))
+  {
+    sim->dropped++;
+    lob_free(packet);
+  }
+  return link;
+}
+
+net_sim_t net_sim_new(uint64_t seed)
+{
+  net_sim_t sim;
+
+  if(!(sim = malloc(sizeof (struct net_sim_struct)))) return LOG("OOM");
+  memset(sim,0,sizeof (struct net_sim_struct));
+  sim->rand = seed ? seed : 0x9E3779B97F4A7C15ULL; // xorshift can't start at 0
+
+  return sim;
+}
+
+// the meshes' clock, ms start at a second so handshakes are never stamped 0, like mesh_process() seconds
+static uint64_t sim_clock(void *arg)
+{
+  return 1000 + ((net_sim_t)arg)->now / 1000;
+}
+
+// a mesh freed before the sim isn't processed anymore, the pipes to and from it go dead and whatever's queued on
+// them is dropped so nothing is delivered to it later
+static void sim_forget(mesh_t mesh)
+{
+  net_sim_t sim;
+  net_sim_pipe_t pipe;
+  uint32_t i, kept;
+  if(mesh->clock != sim_clock) return;
+  sim = (net_sim_t)mesh->clock_arg;
+  for(i = 0; i < sim->meshes_len; i++) if(sim->meshes[i] == mesh)
+  {
+    sim->meshes[i] = sim->meshes[--sim->meshes_len];
+    break;
+  }
+
+  for(kept = i = 0; i < sim->count; i++)
+  {
+    pipe = sim->events[i].pipe;
+    if(pipe->to && pipe->to != mesh && pipe->back->to != mesh)
+    {
+      sim->events[kept++] = sim->events[i];
+      continue;
+    }
+    sim->dropped++;
+    lob_free(sim->events[i].packet);
+  }
+  for(i = 0; i < sim->pipes_len; i++) if(sim->pipes[i]->to == mesh)
+  {
+    sim->pipes[i]->to = NULL;
+    sim->pipes[i]->back->to = NULL;
+  }
+
+  // compacted, so it has to be made a heap again
+  sim->count = kept;
+  for(i = kept / 2; i--;) sim_down(sim, i, sim->events[i]);
+}
+
+void net_sim_free(net_sim_t sim)
+{
+  uint32_t i;
+  if(!sim) return;
+  for(i = 0; i < sim->meshes_len; i++) if(sim->meshes[i]->clock_arg == sim) mesh_clock(sim->meshes[i], NULL, NULL);
+  for(i = 0; i < sim->count; i++) lob_free(sim->events[i].packet);
+  for(i = 0; i < sim->pipes_len; i++)
+  {
+    if(sim->pipes[i]->link) link_unpipe(sim->pipes[i]->link, sim_send, sim->pipes[i]);
+    free(sim->pipes[i]);
+  }
+  free(sim->events);
+  free(sim->pipes);
+  free(sim->meshes);
+  free(sim);
+  return;
+}
+
+// remembered so they can be processed on the virtual clock
+static net_sim_t sim_mesh(net_sim_t sim, mesh_t mesh)
+{
+  mesh_t *meshes;
+  uint32_t i;
+  for(i = 0; i < sim->meshes_len; i++) if(sim->meshes[i] == mesh) return sim;
+  if(!(meshes = realloc(sim->meshes, (sim->meshes_len + 1) * sizeof(mesh_t)))) return LOG("OOM");
+  sim->meshes = meshes;
+  sim->meshes[sim->meshes_len++] = mesh;
+  mesh_clock(mesh, sim_clock, sim);
+  mesh_on_free(mesh, "net_sim", sim_forget);
+  return sim;
+}
+
+static net_sim_pipe_t sim_pipe(net_sim_t sim, mesh_t to, net_sim_path_s *path)
+{
+  net_sim_pipe_t pipe, *pipes;
+  if(!(pipes = realloc(sim->pipes, (sim->pipes_len + 1) * sizeof(net_sim_pipe_t)))) return LOG("OOM");
+  sim->pipes = pipes;
+  if(!(pipe = malloc(sizeof (struct net_sim_pipe_struct)))) return LOG("OOM");
+  memset(pipe,0,sizeof (struct net_sim_pipe_struct));
+  pipe->sim = sim;
+  pipe->to = to;
+  if(path) pipe->path = *path;
+  sim->pipes[sim->pipes_len++] = pipe;
+  return pipe;
+}
+
+net_sim_t net_sim_link(net_sim_t sim, mesh_t a, mesh_t b, net_sim_path_s *path)
+{
+  net_sim_pipe_t ab, ba;
+  link_t link;
+
+  if(!sim || !a || !b) return LOG("bad args");
+  if(!sim_mesh(sim, a) || !sim_mesh(sim, b)) return NULL;
+  if(!(ab = sim_pipe(sim, b, path)) || !(ba = sim_pipe(sim, a, path))) return NULL;
+  ab->back = ba;
+  ba->back = ab;
+
+  // the handshakes this triggers are only queued
+  if(!(link = link_get_keys(a,b->keys)) || !link_pipe(link,sim_send,ab)) return LOG("link to %s failed",hashname_short(b->id));
+  ab->link = link;
+  if(!(link = link_get_keys(b,a->keys)) || !link_pipe(link,sim_send,ba)) return LOG("link to %s failed",hashname_short(a->id));
+  ba->link = link;
+
+  return sim;
+}
+
+net_sim_t net_sim_path(net_sim_t sim, mesh_t a, mesh_t b, net_sim_path_s *path)
+{
+  net_sim_pipe_t pipe;
+  uint32_t i;
+
+  if(!sim || !a || !b) return LOG("bad args");
+  for(i = 0; i < sim->pipes_len; i++)
+  {
+    pipe = sim->pipes[i];
+    if(pipe->to != b || pipe->back->to != a) continue;
+    memset(&pipe->path,0,sizeof(net_sim_path_s));
+    memset(&pipe->back->path,0,sizeof(net_sim_path_s));
+    if(path) pipe->path = pipe->back->path = *path;
+    return sim;
+  }
+  return LOG("%s and %s aren't linked",hashname_short(a->id),hashname_short(b->id));
+}
+
+uint64_t net_sim_now(net_sim_t sim)
+{
+  if(!sim) return 0;
+  return sim->now;
+}
+
+// every mesh gets one mesh_process() per virtual second passed, mesh seconds start at 1
+static void sim_tick(net_sim_t sim)
+{
+  uint32_t second = (uint32_t)(sim->now / 1000000), i;
+  while(sim->second < second)
+  {
+    sim->second++;
+    for(i = 0; i < sim->meshes_len; i++) mesh_process(sim->meshes[i], sim->second + 1);
+  }
+}
+
+uint32_t net_sim_step(net_sim_t sim)
+{
+  net_sim_event_s event;
+  link_t link;
+
+  if(!sim || !sim->count) return 0;
+  event = sim_pop(sim);
+  if(event.at > sim->now) sim->now = event.at;
+  sim_tick(sim);
+  if(!event.pipe->to)
+  {
+    sim->dropped++;
+    lob_free(event.packet);
+    return 1;
+  }
+  sim->delivered++;
+  if((link = mesh_receive(event.pipe->to, event.packet))) link_pipe(link, sim_send, event.pipe->back); // tells it the pipe is working
+  return 1;
+}
+
+uint32_t net_sim_run(net_sim_t sim, uint64_t until)
+{
+  uint32_t count = 0;
+
+  if(!sim) return 0;
+  while(sim->count && sim->events[0].at <= until) count += net_sim_step(sim);
+  if(until > sim->now) sim->now = until;
+  sim_tick(sim);
+  return count;
+}
+
+uint32_t net_sim_pending(net_sim_t sim)
+{
+  if(!sim) return 0;
+  return sim->count;
+}
+
+void net_sim_stats(net_sim_t sim, uint64_t *sent, uint64_t *delivered, uint64_t *dropped)
+{
+  if(!sim) return;
+  if(sent) *sent = sim->sent;
+  if(delivered) *delivered = sim->delivered;
+  if(dropped) *dropped = sim->dropped;
+}
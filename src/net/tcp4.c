@@ -62,7 +62,6 @@ pipe_tcp4_t tcp4_to(pipe_t pipe)
 pipe_t tcp4_flush(pipe_t pipe)
 {
   ssize_t len;
-  lob_t packet;
   uint8_t buf[256];
   pipe_tcp4_t to = tcp4_to(pipe);
   if(!to) return NULL;
@@ -83,8 +82,13 @@ pipe_t tcp4_flush(pipe_t pipe)
     util_chunks_read(to->chunks, buf, (size_t)len);
   }
 
-  // any incoming full packets can be received
-  while((packet = util_chunks_receive(to->chunks))) mesh_receive(to->net->mesh, packet, pipe);
+  // any incoming full packets can be received, a batch at a time
+  lob_t packets[16];
+  size_t count;
+  do {
+    for(count = 0;count < 16 && (packets[count] = util_chunks_receive(to->chunks));count++);
+    if(count) mesh_receive_batch(to->net->mesh, packets, count);
+  } while(count == 16);
 
   if(len < 0 && errno != EWOULDBLOCK && errno != EINPROGRESS)
   {
@@ -3,16 +3,38 @@
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
+#include <netinet/in.h>
 #include "net_udp4.h"
 
+// how many whole packets to hand the mesh at once
+#ifndef UDP4_BATCH
+#define UDP4_BATCH 16
+#endif
+
+// probing stops once the mtu is known to within this
+#define UDP4_PROBE_CLOSE 16
+#define UDP4_PROBE_TRIES 2
+
+// until a peer answers a small probe it gets util_frames like any other udp4 peer, a header datagram and then one
+// with the packet, only after it's answered does it get packets whole and bigger probes
+#define UDP4_FRAMES 1280 // the frames magic
+#define UDP4_HELLO 64 // size of the first probe
+
 // individual pipe local info
 typedef struct pipe_struct
 {
   link_t link;
-  util_frames_t frames;
   net_udp4_t net;
   struct pipe_struct *next;
   struct sockaddr_in sa;
+  util_frames_t frames; // outgoing until whole
+  uint32_t inframe; // size of the framed packet whose header just came in
+  uint8_t whole; // the other side takes (and sends) packets whole
+  uint32_t mtu; // largest payload known to get through
+  uint32_t over; // smallest known not to, one past the max to start
+  uint32_t probe, probe_at; // size in flight and when it went, 0 if none
+  char nonce[17]; // random hex in the probe in flight, only an answer echoing it counts
+  uint8_t tries;
 } *pipe_t;
 
 // overall server
@@ -20,10 +42,17 @@ struct net_udp4_struct
 {
   mesh_t mesh;
   pipe_t pipes;
+  uint8_t *buf; // one NET_UDP4_MTU_MAX datagram
   int server;
   uint16_t port;
 };
 
+static uint32_t udp4_ms(void)
+{
+  uint32_t ms = (uint32_t)(util_sys_ns() / 1000000);
+  return ms ? ms : 1;
+}
+
 static pipe_t pipe_free(pipe_t pipe)
 {
   if(!pipe || !pipe->net || !pipe->net->pipes) return LOG("bad args");
@@ -38,17 +67,51 @@ static pipe_t pipe_free(pipe_t pipe)
     else p->next = pipe->next;
   }
 
-  pipe->frames = util_frames_free(pipe->frames);
+  util_frames_free(pipe->frames);
   free(pipe);
   return NULL;
 }
 
+link_t udp4_send(link_t link, lob_t packet, void *arg);
+
+// let the link size its packets to what the pipe carries
+static void udp4_mtu(pipe_t pipe, uint32_t mtu)
+{
+  pipe->mtu = mtu;
+  if(pipe->link) link_pipe_mtu(link_pipe_get(pipe->link, udp4_send, pipe), mtu);
+}
+
+// one datagram, 0 or the errno
+static int udp4_sendto(pipe_t pipe, uint8_t *raw, size_t len)
+{
+  if(sendto(pipe->net->server, raw, len, 0, (struct sockaddr *)&(pipe->sa), sizeof(struct sockaddr_in)) < 0) return errno ? errno : EIO;
+  return 0;
+}
+
+// sends whatever util_frames has waiting, anything that fails stays queued for the next process
+static void udp4_flush(pipe_t pipe)
+{
+  uint8_t *out;
+  uint32_t len;
+  int err;
+  while((out = util_frames_outbox(pipe->frames,&len)))
+  {
+    if((err = udp4_sendto(pipe, out, len)))
+    {
+      LOG_WARN("sendto failed: %s to %s:%u",strerror(err),inet_ntoa(pipe->sa.sin_addr), ntohs(pipe->sa.sin_port));
+      break;
+    }
+    if(!util_frames_sent(pipe->frames)) break;
+  }
+}
 
 link_t udp4_send(link_t link, lob_t packet, void *arg)
 {
   pipe_t pipe = (pipe_t)arg;
+  size_t len;
+  int err;
   if(!pipe || !link) return NULL;
-  
+
   // request to drop;
   if(!packet)
   {
@@ -57,8 +120,25 @@ link_t udp4_send(link_t link, lob_t packet, void *arg)
   }
 
   LOG_CRAZY("send to %s at %s:%u",hashname_short(link->id),inet_ntoa(pipe->sa.sin_addr), ntohs(pipe->sa.sin_port));
-  util_frames_send(pipe->frames,packet);
+  if(!pipe->whole)
+  {
+    if(!util_frames_send(pipe->frames, packet)) return link; // it freed it
+    udp4_flush(pipe);
+    return link;
+  }
+  len = lob_len(packet);
+  if((err = udp4_sendto(pipe, lob_raw(packet), len)))
+  {
+    // the path got smaller than we thought, start over from the minimum
+    if(err == EMSGSIZE && len <= pipe->mtu)
+    {
+      pipe->over = (uint32_t)len;
+      udp4_mtu(pipe, NET_UDP4_MTU_MIN);
+    }
+    return LOG_WARN("sendto failed: %s to %s:%u",strerror(err),inet_ntoa(pipe->sa.sin_addr), ntohs(pipe->sa.sin_port)); // link_send frees it
+  }
 
+  lob_free(packet);
   return link;
 }
 
@@ -79,8 +159,14 @@ pipe_t udp4_pipe(net_udp4_t net, struct sockaddr_in *from)
   to->sa.sin_family = AF_INET;
   to->sa.sin_addr = from->sin_addr;
   to->sa.sin_port = from->sin_port;
-  to->frames = util_frames_new(1280,42);
-  
+  to->mtu = NET_UDP4_MTU_MIN;
+  to->over = NET_UDP4_MTU_MAX + 1;
+  if(!(to->frames = util_frames_new(UDP4_FRAMES, NET_UDP4_MTU_MAX)))
+  {
+    free(to);
+    return LOG("OOM");
+  }
+
   // link into list
   to->next = net->pipes;
   net->pipes = to;
@@ -88,13 +174,140 @@ pipe_t udp4_pipe(net_udp4_t net, struct sockaddr_in *from)
   return to;
 }
 
+// a probe is padded out to its size, the answer just echoes the size and nonce back
+static lob_t udp4_probe_packet(char *key, uint32_t size, char *nonce, uint32_t pad)
+{
+  lob_t packet = lob_new();
+  lob_set(packet,"type","pmtu");
+  lob_set_uint(packet,key,size);
+  lob_set(packet,"n",nonce);
+  if(pad > lob_len(packet) && !lob_body(packet,NULL,pad - lob_len(packet))) return lob_free(packet);
+  return packet;
+}
+
+// send the next size to try, halving the gap between what's known to work and what isn't
+static void udp4_probe(pipe_t pipe, uint32_t now)
+{
+  uint8_t bytes[8];
+  lob_t packet;
+  int err;
+
+  // give up on a size after it goes unanswered enough
+  if(pipe->probe)
+  {
+    if(now - pipe->probe_at < NET_UDP4_PROBE_MS) return;
+    if(++pipe->tries >= UDP4_PROBE_TRIES)
+    {
+      LOG_DEBUG("no answer to %u byte probe to %s:%u",pipe->probe,inet_ntoa(pipe->sa.sin_addr), ntohs(pipe->sa.sin_port));
+      pipe->over = pipe->whole ? pipe->probe : pipe->mtu; // one that only does frames stays at the minimum
+      pipe->probe = 0;
+    }
+  }
+
+  if(!pipe->probe)
+  {
+    if(pipe->over - pipe->mtu <= UDP4_PROBE_CLOSE) return;
+    pipe->probe = pipe->whole ? pipe->mtu + (pipe->over - pipe->mtu) / 2 : UDP4_HELLO;
+    pipe->tries = 0;
+  }
+
+  // a fresh nonce each time so nobody else can answer for the peer
+  util_hex(e3x_rand(bytes, sizeof(bytes)), sizeof(bytes), pipe->nonce);
+  if(!(packet = udp4_probe_packet("probe", pipe->probe, pipe->nonce, pipe->probe))) return;
+  err = udp4_sendto(pipe, lob_raw(packet), lob_len(packet));
+  lob_free(packet);
+
+  // too big for the interface or a path the kernel already knows about
+  if(err == EMSGSIZE)
+  {
+    pipe->over = pipe->probe;
+    pipe->probe = 0;
+    return;
+  }
+  pipe->probe_at = now;
+}
+
+// handles probes and their answers, true if it was one
+static uint8_t udp4_probed(pipe_t pipe, lob_t packet)
+{
+  uint32_t size;
+  char *nonce;
+  lob_t answer;
+
+  if(packet->head_len < 7 || lob_get_cmp(packet,"type","pmtu")) return 0;
+
+  if((size = lob_get_uint(packet,"probe")))
+  {
+    if(size == lob_len(packet) && (nonce = lob_get(packet,"n")) && (answer = udp4_probe_packet("probed", size, nonce, 0)))
+    {
+      udp4_sendto(pipe, lob_raw(answer), lob_len(answer));
+      lob_free(answer);
+    }
+  }else if((size = lob_get_uint(packet,"probed")) && size == pipe->probe && lob_get_cmp(packet,"n",pipe->nonce) == 0){
+    pipe->probe = 0;
+    if(!pipe->whole) LOG_DEBUG("sending whole packets to %s:%u",inet_ntoa(pipe->sa.sin_addr), ntohs(pipe->sa.sin_port));
+    pipe->whole = 1;
+    if(size > pipe->mtu)
+    {
+      LOG_DEBUG("mtu to %s:%u is at least %u",inet_ntoa(pipe->sa.sin_addr), ntohs(pipe->sa.sin_port),size);
+      udp4_mtu(pipe, size);
+    }
+  }
+
+  lob_free(packet);
+  return 1;
+}
+
+// a whole packet, or the two datagrams a framed one comes in, NULL until there's a packet
+static lob_t udp4_packet(pipe_t pipe, uint8_t *buf, size_t len)
+{
+  uint32_t magic, size;
+  lob_t packet;
+
+  // the rest of a framed one always comes as the next datagram, anything else and it was lost
+  if(pipe->inframe)
+  {
+    size = pipe->inframe;
+    pipe->inframe = 0;
+    if(len == size) return lob_parse(buf, len);
+    LOG_DEBUG("lost a %u byte framed packet from %s:%u",size,inet_ntoa(pipe->sa.sin_addr), ntohs(pipe->sa.sin_port));
+  }
+
+  // a frames header (a whole packet is never 8 bytes with a 5 byte head of zeros)
+  if(len == 8)
+  {
+    memcpy(&magic, buf, 4);
+    memcpy(&size, buf + 4, 4);
+    if(magic == UDP4_FRAMES)
+    {
+      if(size && size <= NET_UDP4_MTU_MAX) pipe->inframe = size;
+      return NULL;
+    }
+  }
+
+  if(!(packet = lob_parse(buf, len))) LOG_WARN("dropping unparseable %ld bytes",(long)len);
+  return packet;
+}
+
+// hand a run of packets from the same pipe to the mesh
+static void udp4_deliver(pipe_t pipe, lob_t *packets, size_t count)
+{
+  link_t link;
+  if(!count) return;
+  if(!(link = mesh_receive_batch(pipe->net->mesh, packets, count))) return;
+  if(link != pipe->link) LOG_DEBUG("adding new link to pipe for %s",hashname_short(link->id));
+  pipe->link = link;
+  link_pipe(link,udp4_send,pipe); // also tells the link the pipe is working
+  link_pipe_mtu(link_pipe_get(link,udp4_send,pipe), pipe->mtu);
+}
+
 net_udp4_t net_udp4_new(mesh_t mesh, lob_t options)
 {
   int port, sock;
   net_udp4_t net;
   struct sockaddr_in sa;
   socklen_t size = sizeof(struct sockaddr_in);
-  
+
   port = lob_get_int(options,"port");
 
   // create a udp socket
@@ -103,6 +316,12 @@ net_udp4_t net_udp4_new(mesh_t mesh, lob_t options)
   // TODO this needs to be modified for app usage
   util_sock_timeout(sock,1);
 
+#ifdef IP_MTU_DISCOVER
+  // never fragment, too big is an error instead and that's what probing relies on
+  int pmtu = IP_PMTUDISC_DO;
+  if(setsockopt(sock, IPPROTO_IP, IP_MTU_DISCOVER, &pmtu, sizeof(pmtu)) < 0) LOG_WARN("IP_MTU_DISCOVER failed %s",strerror(errno));
+#endif
+
   memset(&sa,0,sizeof(sa));
   sa.sin_family = AF_INET;
   sa.sin_port = htons(port);
@@ -120,6 +339,12 @@ net_udp4_t net_udp4_new(mesh_t mesh, lob_t options)
     return LOG_ERROR("OOM");
   }
   memset(net,0,sizeof (struct net_udp4_struct));
+  if(!(net->buf = malloc(NET_UDP4_MTU_MAX)))
+  {
+    free(net);
+    close(sock);
+    return LOG_ERROR("OOM");
+  }
   net->mesh = mesh;
   net->server = sock;
   net->port = ntohs(sa.sin_port);
@@ -131,7 +356,15 @@ net_udp4_t net_udp4_free(net_udp4_t net)
 {
   if(!net) return NULL;
   LOG_DEBUG("closing udp4 transport on %u",net->port);
+
+  // links let go of their pipes first
+  while(net->pipes)
+  {
+    if(net->pipes->link) link_unpipe(net->pipes->link, udp4_send, net->pipes);
+    pipe_free(net->pipes);
+  }
   close(net->server);
+  free(net->buf);
   free(net);
   return NULL;
 }
@@ -141,65 +374,50 @@ net_udp4_t net_udp4_process(net_udp4_t net)
   if(!net) return LOG_WARN("bad args");
 
   struct sockaddr_in sa;
-  size_t salen = sizeof(sa);
-  memset(&sa,0,salen);
-  uint8_t frame[1280];
-  
-  // try receiving anything waiting
-  pipe_t pipe = NULL;
+  socklen_t salen;
+  lob_t packet, packets[UDP4_BATCH];
+  size_t count = 0;
+
+  // try receiving anything waiting, runs from the same pipe go to the mesh together
+  pipe_t pipe = NULL, from;
   while(1)
   {
-    ssize_t len = recvfrom(net->server, frame, sizeof(frame), 0, (struct sockaddr *)&sa, (socklen_t *)&salen);
+    salen = sizeof(sa);
+    memset(&sa,0,salen);
+    ssize_t len = recvfrom(net->server, net->buf, NET_UDP4_MTU_MAX, 0, (struct sockaddr *)&sa, &salen);
     if(len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
     if(len <= 0)
     {
       LOG_WARN("recvfrom error %s",strerror(errno));
       break;
     }
-    
-    // get the pipe and return
-    if(!pipe || memcmp(&(pipe->sa.sin_addr), &(sa.sin_addr), sizeof(struct in_addr)) || pipe->sa.sin_port != sa.sin_port) pipe = udp4_pipe(net, &sa);
-    if(pipe)
+
+    // get the pipe
+    from = pipe;
+    if(!from || memcmp(&(from->sa.sin_addr), &(sa.sin_addr), sizeof(struct in_addr)) || from->sa.sin_port != sa.sin_port) from = udp4_pipe(net, &sa);
+    if(!from) continue;
+    if(from != pipe || count == UDP4_BATCH)
     {
-      LOG_CRAZY("receive from %s at %s:%u",(pipe->link)?hashname_short(pipe->link->id):"unknown",inet_ntoa(pipe->sa.sin_addr), ntohs(pipe->sa.sin_port));
-      util_frames_inbox(pipe->frames, frame, len);
+      if(pipe) udp4_deliver(pipe, packets, count);
+      pipe = from;
+      count = 0;
     }
+
+    LOG_CRAZY("receive from %s at %s:%u",(pipe->link)?hashname_short(pipe->link->id):"unknown",inet_ntoa(pipe->sa.sin_addr), ntohs(pipe->sa.sin_port));
+    if(!(packet = udp4_packet(pipe, net->buf, (size_t)len))) continue;
+    if(udp4_probed(pipe, packet)) continue;
+    packets[count++] = packet;
   }
+  if(pipe) udp4_deliver(pipe, packets, count);
 
-  // process each pipe also
-  pipe_t next = NULL;
-  for(pipe = net->pipes;pipe;pipe = next)
+  // only pipes that are carrying a link are worth probing, and retry any frames that didn't go
+  uint32_t now = udp4_ms();
+  for(pipe = net->pipes; pipe; pipe = pipe->next)
   {
-    next = pipe->next;
-    
-    // process received full packets
-    lob_t packet = NULL;
-    while((packet = util_frames_receive(pipe->frames)))
-    {
-      link_t link = mesh_receive(net->mesh, packet);
-      if(!link) continue;
-      if(link != pipe->link)
-      {
-        LOG_DEBUG("adding new link to pipe for %s",hashname_short(link->id));
-        pipe->link = link;
-        link_pipe(link,udp4_send,pipe);
-      }
-    }
-    
-    // send all/any waiting frames
-    uint8_t *out = NULL;
-    while((out = util_frames_outbox(pipe->frames)))
-    {
-      if(sendto(net->server, out, util_frames_pending(pipe->frames), 0, (struct sockaddr *)&(pipe->sa), sizeof(struct sockaddr_in)) < 0)
-      {
-        LOG_WARN("sendto failed: %s to %s:%u",strerror(errno),inet_ntoa(pipe->sa.sin_addr), ntohs(pipe->sa.sin_port));
-        break;
-      }
-      // only continue if sent says there's more
-      if(!util_frames_sent(pipe->frames)) break;
-    }
+    udp4_flush(pipe);
+    if(pipe->link) udp4_probe(pipe, now);
   }
-  
+
   return net;
 }
 
@@ -215,6 +433,18 @@ uint16_t net_udp4_port(net_udp4_t net)
   return net->port;
 }
 
+uint32_t net_udp4_mtu(net_udp4_t net, char *ip, uint16_t port)
+{
+  pipe_t pipe;
+  struct sockaddr_in sa;
+  if(!net || !ip || !port) return 0;
+  memset(&sa,0,sizeof(sa));
+  if(!inet_aton(ip, &(sa.sin_addr))) return 0;
+  sa.sin_port = htons(port);
+  for(pipe = net->pipes; pipe; pipe = pipe->next) if(pipe->sa.sin_addr.s_addr == sa.sin_addr.s_addr && pipe->sa.sin_port == sa.sin_port) return pipe->mtu;
+  return NET_UDP4_MTU_MIN;
+}
+
 net_udp4_t net_udp4_direct(net_udp4_t net, lob_t packet, char *ip, uint16_t port)
 {
   if(!net || !packet || !ip || !port) return LOG_WARN("bad args");
@@ -224,12 +454,19 @@ net_udp4_t net_udp4_direct(net_udp4_t net, lob_t packet, char *ip, uint16_t port
   inet_aton(ip, &(sa.sin_addr));
   sa.sin_port = htons(port);
   pipe_t pipe = udp4_pipe(net, &sa);
-  if(!port)
+  if(!pipe)
   {
     lob_free(packet);
     return LOG_WARN("direct pipe failed to %s:%u",ip,port);
   }
-  util_frames_send(pipe->frames,packet);
+  if(!pipe->whole)
+  {
+    if(util_frames_send(pipe->frames, packet)) udp4_flush(pipe);
+    return net;
+  }
+  int err = udp4_sendto(pipe, lob_raw(packet), lob_len(packet));
+  lob_free(packet);
+  if(err) return LOG_WARN("direct send failed to %s:%u %s",ip,port,strerror(err));
   return net;
 }
 
@@ -0,0 +1,541 @@
+#if !defined(_WIN32) && (defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__)))
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // recvmmsg, sendmmsg and memfd_create
+#endif
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#include "net_unix.h"
+
+#ifdef __linux__
+typedef struct mmsghdr unix_msg_s;
+#else
+// same shape, sent and received one at a time
+typedef struct unix_msg_struct
+{
+  struct msghdr msg_hdr;
+  unsigned int msg_len;
+} unix_msg_s;
+#endif
+
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+#define UNIX_MEMFD
+#endif
+
+// never read more than this out of a memfd
+#define UNIX_MEMFD_MAX (64*1024*1024)
+
+// individual pipe local info
+typedef struct pipe_struct
+{
+  link_t link;
+  net_unix_t net;
+  struct pipe_struct *next;
+  struct sockaddr_un sa;
+  socklen_t salen;
+  uint32_t queued; // in net->out
+  uint8_t blocked; // its socket was full this flush
+} *pipe_t;
+
+// overall server
+struct net_unix_struct
+{
+  mesh_t mesh;
+  pipe_t pipes;
+  lob_t out, out_end; // waiting to be sent, each one's arg is its pipe
+  uint8_t *bufs; // NET_UNIX_BATCH receive buffers of NET_UNIX_MTU
+  uint32_t memfd;
+  int server;
+  struct sockaddr_un sa;
+};
+
+static pipe_t pipe_free(pipe_t pipe)
+{
+  lob_t packet, next;
+  if(!pipe || !pipe->net || !pipe->net->pipes) return LOG("bad args");
+  LOG_DEBUG("dropping pipe %s",pipe->sa.sun_path);
+
+  // remove from pipes list
+  if(pipe == pipe->net->pipes) pipe->net->pipes = pipe->next;
+  else {
+    pipe_t p = pipe->net->pipes;
+    while(p && p->next != pipe) p = p->next;
+    if(!p) LOG_WARN("pipe not found for %s",pipe->sa.sun_path);
+    else p->next = pipe->next;
+  }
+
+  // and anything still waiting to go out on it
+  for(packet = pipe->net->out; packet; packet = next)
+  {
+    next = packet->next;
+    if(packet->arg != pipe) continue;
+    if(packet == pipe->net->out_end) pipe->net->out_end = packet->prev;
+    pipe->net->out = lob_splice(pipe->net->out, packet);
+    lob_free(packet);
+  }
+
+  free(pipe);
+  return NULL;
+}
+
+// queued for the next batch, unless too many are already waiting on that socket
+static pipe_t unix_queue(net_unix_t net, pipe_t pipe, lob_t packet)
+{
+  if(pipe->queued >= NET_UNIX_QUEUE) return LOG_WARN("%u waiting, dropping %lu bytes to %s",pipe->queued,(unsigned long)lob_len(packet),pipe->sa.sun_path);
+  pipe->queued++;
+  packet->arg = pipe;
+  packet->next = NULL;
+  packet->prev = net->out_end;
+  if(net->out_end) net->out_end->next = packet;
+  else net->out = packet;
+  net->out_end = packet;
+  return pipe;
+}
+
+link_t unix_send(link_t link, lob_t packet, void *arg)
+{
+  pipe_t pipe = (pipe_t)arg;
+  net_unix_t net;
+  if(!pipe || !link) return NULL;
+  net = pipe->net;
+
+  // request to drop;
+  if(!packet)
+  {
+    pipe = pipe_free(pipe);
+    return link;
+  }
+
+  if(lob_len(packet) > NET_UNIX_MTU && !net->memfd) return LOG_WARN("%lu bytes is too big to send to %s",(unsigned long)lob_len(packet),pipe->sa.sun_path); // link_send frees it
+
+  LOG_CRAZY("send to %s at %s",hashname_short(link->id),pipe->sa.sun_path);
+  if(!unix_queue(net, pipe, packet)) return NULL; // link_send frees it
+
+  return link;
+}
+
+// internal, get or create a pipe
+pipe_t unix_pipe(net_unix_t net, struct sockaddr_un *from, socklen_t len)
+{
+  pipe_t to;
+
+  if(len <= offsetof(struct sockaddr_un, sun_path) || !from->sun_path[0]) return LOG_WARN("unbound sender");
+
+  // find existing
+  for(to = net->pipes; to; to = to->next) if(to->salen == len && memcmp(&(to->sa),from,len) == 0) return to;
+
+  LOG("new pipe to %s",from->sun_path);
+
+  // create new unix pipe
+  if(!(to = malloc(sizeof (struct pipe_struct)))) return LOG("OOM");
+  memset(to,0,sizeof (struct pipe_struct));
+  to->net = net;
+  memcpy(&(to->sa),from,len);
+  to->salen = len;
+
+  // link into list
+  to->next = net->pipes;
+  net->pipes = to;
+
+  return to;
+}
+
+static pipe_t unix_path(net_unix_t net, char *path)
+{
+  struct sockaddr_un sa;
+  size_t len;
+  if(!path || !(len = strlen(path)) || len >= sizeof(sa.sun_path)) return LOG_WARN("bad path");
+  memset(&sa,0,sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  memcpy(sa.sun_path,path,len);
+  return unix_pipe(net, &sa, (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len + 1));
+}
+
+net_unix_t net_unix_new(mesh_t mesh, lob_t options)
+{
+  int sock;
+  net_unix_t net;
+  struct sockaddr_un sa;
+  char *path;
+
+  path = lob_get(options,"path");
+  if(!mesh || !path || !strlen(path) || strlen(path) >= sizeof(sa.sun_path)) return LOG_WARN("bad args");
+
+  // create a datagram socket
+  if((sock = socket(AF_UNIX, SOCK_DGRAM, 0)) < 0) return LOG_ERROR("failed to create socket %s",strerror(errno));
+  fcntl(sock, F_SETFL, O_NONBLOCK);
+
+  memset(&sa,0,sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  strcpy(sa.sun_path,path);
+  unlink(path);
+  if(bind(sock, (struct sockaddr*)&sa, sizeof(sa)) < 0)
+  {
+    close(sock);
+    return LOG_ERROR("bind to %s failed %s",path,strerror(errno));
+  }
+
+  if(!(net = malloc(sizeof (struct net_unix_struct))))
+  {
+    close(sock);
+    unlink(path);
+    return LOG_ERROR("OOM");
+  }
+  memset(net,0,sizeof (struct net_unix_struct));
+  if(!(net->bufs = malloc(NET_UNIX_BATCH * NET_UNIX_MTU)))
+  {
+    free(net);
+    close(sock);
+    unlink(path);
+    return LOG_ERROR("OOM");
+  }
+  net->mesh = mesh;
+  net->server = sock;
+  net->sa = sa;
+
+#ifdef UNIX_MEMFD
+  net->memfd = lob_get(options,"memfd") ? lob_get_uint(options,"memfd") : NET_UNIX_MTU;
+  if(net->memfd > NET_UNIX_MTU) net->memfd = NET_UNIX_MTU;
+#endif
+
+  return net;
+}
+
+net_unix_t net_unix_free(net_unix_t net)
+{
+  pipe_t pipe;
+  if(!net) return NULL;
+  LOG_DEBUG("closing unix transport on %s",net->sa.sun_path);
+
+  // don't leave links pointing at the pipes
+  while((pipe = net->pipes))
+  {
+    if(pipe->link) link_unpipe(pipe->link, unix_send, pipe);
+    pipe_free(pipe);
+  }
+  lob_freeall(net->out);
+  close(net->server);
+  unlink(net->sa.sun_path);
+  free(net->bufs);
+  free(net);
+  return NULL;
+}
+
+#ifdef UNIX_MEMFD
+// a memfd holding the packet to hand over instead
+static int unix_memfd(lob_t packet)
+{
+  uint8_t *raw = lob_raw(packet);
+  size_t len = lob_len(packet);
+  ssize_t wrote;
+  int fd;
+
+  if((fd = memfd_create("telehash", MFD_CLOEXEC)) < 0)
+  {
+    LOG_WARN("memfd_create failed %s",strerror(errno));
+    return -1;
+  }
+  while(len)
+  {
+    if((wrote = write(fd, raw, len)) <= 0)
+    {
+      LOG_WARN("memfd write failed %s",strerror(errno));
+      close(fd);
+      return -1;
+    }
+    raw += wrote;
+    len -= (size_t)wrote;
+  }
+  return fd;
+}
+#endif
+
+// a received datagram, either the packet itself or the size of the one in the memfd that came with it
+static lob_t unix_packet(unix_msg_s *msg, uint8_t *buf)
+{
+  struct cmsghdr *cmsg;
+  uint64_t len;
+  uint8_t *raw;
+  lob_t packet;
+  int fd = -1;
+
+  for(cmsg = CMSG_FIRSTHDR(&msg->msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&msg->msg_hdr, cmsg))
+  {
+    if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+    if(fd >= 0) close(fd);
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+  }
+
+  if(msg->msg_hdr.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+  {
+    if(fd >= 0) close(fd);
+    return LOG_WARN("dropping truncated datagram");
+  }
+
+  if(fd < 0) return lob_parse(buf, msg->msg_len);
+
+  if(msg->msg_len != sizeof(len))
+  {
+    close(fd);
+    return LOG_WARN("bad memfd datagram");
+  }
+  memcpy(&len, buf, sizeof(len));
+  if(len < 2 || len > UNIX_MEMFD_MAX || !(raw = malloc(len)))
+  {
+    close(fd);
+    return LOG_WARN("bad memfd size %llu",(unsigned long long)len);
+  }
+  if(pread(fd, raw, len, 0) != (ssize_t)len)
+  {
+    LOG_WARN("memfd read failed %s",strerror(errno));
+    close(fd);
+    free(raw);
+    return NULL;
+  }
+  close(fd);
+  if(!(packet = lob_direct(raw, len))) free(raw);
+  return packet;
+}
+
+// pipe the link over it, packets under the memfd size go whole in one datagram
+static link_t unix_link(pipe_t pipe, link_t link)
+{
+  pipe->link = link;
+  if(!link_pipe(link,unix_send,pipe)) return NULL;
+  link_pipe_mtu(link_pipe_get(link,unix_send,pipe), pipe->net->memfd ? pipe->net->memfd - 1 : NET_UNIX_MTU);
+  return link;
+}
+
+// hand a run of packets from the same sender to the mesh
+static void unix_deliver(net_unix_t net, struct sockaddr_un *from, socklen_t len, lob_t *packets, size_t count)
+{
+  pipe_t pipe;
+  link_t link;
+  size_t i;
+
+  if(!count) return;
+  if(!(pipe = unix_pipe(net, from, len)))
+  {
+    for(i = 0; i < count; i++) lob_free(packets[i]);
+    return;
+  }
+  LOG_CRAZY("receive %lu from %s at %s",(unsigned long)count,(pipe->link)?hashname_short(pipe->link->id):"unknown",pipe->sa.sun_path);
+  if(!(link = mesh_receive_batch(net->mesh, packets, count))) return;
+  if(link != pipe->link) LOG_DEBUG("adding new link to pipe for %s",hashname_short(link->id));
+  unix_link(pipe, link); // also tells the link the pipe is working
+}
+
+static int unix_recvmmsg(int sock, unix_msg_s *msgs, unsigned int count)
+{
+#ifdef __linux__
+  return recvmmsg(sock, msgs, count, MSG_CMSG_CLOEXEC, NULL);
+#else
+  unsigned int i;
+  ssize_t len;
+  for(i = 0; i < count; i++)
+  {
+    if((len = recvmsg(sock, &msgs[i].msg_hdr, 0)) < 0) break;
+    msgs[i].msg_len = (unsigned int)len;
+  }
+  return i ? (int)i : -1;
+#endif
+}
+
+static int unix_sendmmsg(int sock, unix_msg_s *msgs, unsigned int count)
+{
+#ifdef __linux__
+  return sendmmsg(sock, msgs, count, 0);
+#else
+  unsigned int i;
+  for(i = 0; i < count; i++) if(sendmsg(sock, &msgs[i].msg_hdr, 0) < 0) break;
+  return i ? (int)i : -1;
+#endif
+}
+
+static void unix_receive(net_unix_t net)
+{
+  unix_msg_s msgs[NET_UNIX_BATCH];
+  struct iovec iovs[NET_UNIX_BATCH];
+  struct sockaddr_un from[NET_UNIX_BATCH];
+  union { char buf[CMSG_SPACE(sizeof(int))]; struct cmsghdr align; } ctrl[NET_UNIX_BATCH];
+  lob_t packets[NET_UNIX_BATCH];
+  int count, i, first;
+  size_t len;
+
+  do {
+    memset(msgs,0,sizeof(msgs));
+    for(i = 0; i < NET_UNIX_BATCH; i++)
+    {
+      iovs[i].iov_base = net->bufs + i * NET_UNIX_MTU;
+      iovs[i].iov_len = NET_UNIX_MTU;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = &from[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_un);
+      msgs[i].msg_hdr.msg_control = ctrl[i].buf;
+      msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i].buf);
+    }
+
+    if((count = unix_recvmmsg(net->server, msgs, NET_UNIX_BATCH)) < 0)
+    {
+      if(errno != EAGAIN && errno != EWOULDBLOCK) LOG_WARN("recvmmsg error %s",strerror(errno));
+      break;
+    }
+
+    // runs from the same sender are delivered together
+    for(len = 0, first = i = 0; i < count; i++)
+    {
+      if(len && (msgs[i].msg_hdr.msg_namelen != msgs[first].msg_hdr.msg_namelen || memcmp(&from[i],&from[first],msgs[i].msg_hdr.msg_namelen)))
+      {
+        unix_deliver(net, &from[first], msgs[first].msg_hdr.msg_namelen, packets, len);
+        len = 0;
+      }
+      if(!len) first = i;
+      if((packets[len] = unix_packet(&msgs[i], iovs[i].iov_base))) len++;
+    }
+    unix_deliver(net, &from[first], msgs[first].msg_hdr.msg_namelen, packets, len);
+  } while(count == NET_UNIX_BATCH);
+}
+
+static void unix_flush(net_unix_t net)
+{
+  unix_msg_s msgs[NET_UNIX_BATCH];
+  struct iovec iovs[NET_UNIX_BATCH];
+  union { char buf[CMSG_SPACE(sizeof(int))]; struct cmsghdr align; } ctrl[NET_UNIX_BATCH];
+  uint64_t lens[NET_UNIX_BATCH];
+  int fds[NET_UNIX_BATCH];
+  lob_t batch[NET_UNIX_BATCH], packet, next;
+  pipe_t pipe;
+  int count, sent, i;
+
+  // a full socket only holds back what's going to it, the rest keep going
+  for(pipe = net->pipes; pipe; pipe = pipe->next) pipe->blocked = 0;
+
+  while(net->out)
+  {
+    memset(msgs,0,sizeof(msgs));
+    for(count = 0, packet = net->out; count < NET_UNIX_BATCH && packet; packet = next)
+    {
+      next = packet->next;
+      pipe = (pipe_t)packet->arg;
+      if(pipe->blocked) continue;
+      if(packet == net->out_end) net->out_end = packet->prev;
+      net->out = lob_splice(net->out, packet);
+      pipe->queued--;
+
+      fds[count] = -1;
+      iovs[count].iov_base = lob_raw(packet);
+      iovs[count].iov_len = lob_len(packet);
+      msgs[count].msg_hdr.msg_name = &(pipe->sa);
+      msgs[count].msg_hdr.msg_namelen = pipe->salen;
+      msgs[count].msg_hdr.msg_iov = &iovs[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+
+#ifdef UNIX_MEMFD
+      // big ones go over as a memfd and just their size in the datagram
+      if(net->memfd && lob_len(packet) >= net->memfd && (fds[count] = unix_memfd(packet)) >= 0)
+      {
+        struct cmsghdr *cmsg;
+        lens[count] = lob_len(packet);
+        iovs[count].iov_base = &lens[count];
+        iovs[count].iov_len = sizeof(lens[count]);
+        msgs[count].msg_hdr.msg_control = ctrl[count].buf;
+        msgs[count].msg_hdr.msg_controllen = sizeof(ctrl[count].buf);
+        cmsg = CMSG_FIRSTHDR(&msgs[count].msg_hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fds[count], sizeof(int));
+      }
+#endif
+      if(fds[count] < 0 && lob_len(packet) > NET_UNIX_MTU)
+      {
+        LOG_WARN("dropping %lu bytes to %s",(unsigned long)lob_len(packet),pipe->sa.sun_path);
+        lob_free(packet);
+        continue;
+      }
+      batch[count++] = packet;
+    }
+    if(!count) break;
+
+    if((sent = unix_sendmmsg(net->server, msgs, (unsigned int)count)) < 0)
+    {
+      // that receiver is full, its packets wait for next time, anything else only fails the first one
+      if(errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+      {
+        sent = 0;
+        ((pipe_t)batch[0]->arg)->blocked = 1;
+      }else{
+        LOG_WARN("sendmmsg failed: %s to %s",strerror(errno),((pipe_t)batch[0]->arg)->sa.sun_path);
+        sent = 1;
+      }
+    }
+    for(i = 0; i < count; i++) if(fds[i] >= 0) close(fds[i]);
+    for(i = 0; i < sent; i++) lob_free(batch[i]);
+
+    // put back whatever didn't go, in order, each one is still ahead of the rest going to its pipe
+    for(i = count - 1; i >= sent; i--)
+    {
+      ((pipe_t)batch[i]->arg)->queued++;
+      batch[i]->next = net->out;
+      if(net->out) net->out->prev = batch[i];
+      else net->out_end = batch[i];
+      net->out = batch[i];
+    }
+  }
+}
+
+net_unix_t net_unix_process(net_unix_t net)
+{
+  if(!net) return LOG_WARN("bad args");
+  unix_receive(net);
+  unix_flush(net);
+  return net;
+}
+
+int net_unix_socket(net_unix_t net)
+{
+  if(!net) return -1;
+  return net->server;
+}
+
+char *net_unix_path(net_unix_t net)
+{
+  if(!net) return NULL;
+  return net->sa.sun_path;
+}
+
+link_t net_unix_link(net_unix_t net, link_t link, char *path)
+{
+  pipe_t pipe;
+  if(!net || !link || !path) return LOG_WARN("bad args");
+  if(!(pipe = unix_path(net, path))) return NULL;
+  return unix_link(pipe, link);
+}
+
+net_unix_t net_unix_direct(net_unix_t net, lob_t packet, char *path)
+{
+  pipe_t pipe;
+  if(!net || !packet || !path) return LOG_WARN("bad args");
+
+  if(!(pipe = unix_path(net, path)))
+  {
+    lob_free(packet);
+    return LOG_WARN("direct pipe failed to %s",path);
+  }
+  if(!unix_queue(net, pipe, packet))
+  {
+    lob_free(packet);
+    return NULL;
+  }
+  return net;
+}
+
+#endif // POSIX
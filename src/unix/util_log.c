@@ -0,0 +1,322 @@
+#if !defined(_WIN32) && (defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__)))
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "telehash.h"
+
+// each slot holds one record with its file, function and message text back to back
+#define LOG_TEXT 384
+#define LOG_FILE 63
+#define LOG_FUNC 47
+
+// binary records are this header (little endian) followed by the text
+// at(8) repeats(4) line(2) level(1) file_len(1) func_len(1) msg_len(2)
+#define LOG_HEADER 19
+
+// call sites tracked for repeat suppression
+#define LOG_SITES 64
+
+// how long the writer sleeps when there's nothing to do
+#define LOG_IDLE_US 1000
+
+typedef struct log_record_struct
+{
+  uint64_t at; // microseconds since the epoch
+  uint32_t repeats; // suppressed from the same call site just before this one
+  uint16_t line;
+  uint8_t level;
+  uint8_t file_len;
+  uint8_t func_len;
+  uint16_t msg_len;
+  char text[LOG_TEXT];
+} log_record_s;
+
+// bounded multi-producer queue, a slot is free for position p when seq == p and full when seq == p+1
+typedef struct log_slot_struct
+{
+  uint64_t seq;
+  log_record_s rec;
+} log_slot_s;
+
+typedef struct log_site_struct
+{
+  uintptr_t key;
+  uint64_t window; // second this count is for
+  uint32_t count;
+  uint32_t suppressed;
+} log_site_s;
+
+static struct
+{
+  log_slot_s *slots;
+  uint64_t mask;
+  uint64_t head; // next position producers claim
+  uint64_t tail; // next position the writer reads, only it touches this
+  FILE *text;
+  FILE *bin;
+  pthread_t thread;
+  int running; // producers may push
+  int stopping; // writer should drain and exit
+  uint32_t inflight; // producers between checking running and publishing
+  uint32_t burst;
+  uint64_t written, dropped, suppressed, reported;
+  log_site_s sites[LOG_SITES];
+} ring = {.burst = 20};
+
+#define LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define STORE(x,v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#define ADD(x,v) __atomic_add_fetch(&(x), (v), __ATOMIC_ACQ_REL)
+
+// running and inflight are a store-then-load handshake each way (producer adds then rechecks running, stop clears
+// running then checks inflight), only sequential consistency keeps both sides from missing the other
+#define SC_LOAD(x) __atomic_load_n(&(x), __ATOMIC_SEQ_CST)
+#define SC_STORE(x,v) __atomic_store_n(&(x), (v), __ATOMIC_SEQ_CST)
+#define SC_ADD(x,v) __atomic_add_fetch(&(x), (v), __ATOMIC_SEQ_CST)
+
+static uint64_t log_now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+// 0 to drop this record, else 1 + how many were dropped since the last one that went through
+static uint32_t log_site(const char *file, int line, uint64_t at)
+{
+  uintptr_t key = (uintptr_t)file ^ ((uintptr_t)line << 1) ^ 1;
+  log_site_s *site = &ring.sites[(((uintptr_t)file >> 4) ^ (uintptr_t)line) % LOG_SITES];
+  uint64_t second = at / 1000000;
+  uint32_t burst = LOAD(ring.burst);
+  if(!burst) return 1;
+
+  // a new site or a new second starts counting over, and hands back what was held in the last one
+  // (another thread racing on the same site may lose an update, this is only a limiter)
+  if(LOAD(site->key) != key || LOAD(site->window) != second)
+  {
+    STORE(site->key, key);
+    STORE(site->window, second);
+    STORE(site->count, 1);
+    return __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_ACQ_REL) + 1;
+  }
+  if(ADD(site->count, 1) <= burst) return __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_ACQ_REL) + 1;
+  ADD(site->suppressed, 1);
+  ADD(ring.suppressed, 1);
+  return 0;
+}
+
+int util_log_vpush(uint8_t level, const char *file, int line, const char *function, const char *format, va_list args)
+{
+  uint64_t pos, seq;
+  uint32_t repeats;
+  log_slot_s *slot;
+  log_record_s *rec;
+  size_t len;
+  int n;
+
+  if(!LOAD(ring.running)) return 0;
+  SC_ADD(ring.inflight, 1);
+  if(!SC_LOAD(ring.running))
+  {
+    ADD(ring.inflight, -1);
+    return 0;
+  }
+
+  uint64_t at = log_now();
+  if(!(repeats = log_site(file, line, at)))
+  {
+    ADD(ring.inflight, -1);
+    return 1;
+  }
+
+  // claim a position, a slot still holding an unwritten record means the ring is full
+  pos = __atomic_load_n(&ring.head, __ATOMIC_RELAXED);
+  for(;;)
+  {
+    slot = &ring.slots[pos & ring.mask];
+    seq = LOAD(slot->seq);
+    if(seq == pos)
+    {
+      if(__atomic_compare_exchange_n(&ring.head, &pos, pos+1, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) break;
+    }else if(seq < pos){
+      ADD(ring.dropped, 1);
+      ADD(ring.inflight, -1);
+      return 1;
+    }else{
+      pos = __atomic_load_n(&ring.head, __ATOMIC_RELAXED);
+    }
+  }
+
+  // only the message is formatted here, the writer puts the rest of the line together
+  rec = &slot->rec;
+  rec->at = at;
+  rec->repeats = repeats - 1;
+  rec->line = (uint16_t)line;
+  rec->level = level;
+  len = file ? strlen(file) : 0;
+  if(len > LOG_FILE) file += len - LOG_FILE, len = LOG_FILE; // keep the end of long paths
+  rec->file_len = (uint8_t)len;
+  if(len) memcpy(rec->text, file, len);
+  len = function ? strlen(function) : 0;
+  if(len > LOG_FUNC) len = LOG_FUNC;
+  rec->func_len = (uint8_t)len;
+  if(len) memcpy(rec->text+rec->file_len, function, len);
+  len = rec->file_len + rec->func_len;
+  n = vsnprintf(rec->text+len, LOG_TEXT-len, format, args);
+  if(n < 0) n = 0;
+  if((size_t)n >= LOG_TEXT-len) n = (int)(LOG_TEXT-len-1);
+  rec->msg_len = (uint16_t)n;
+
+  STORE(slot->seq, pos+1);
+  ADD(ring.inflight, -1);
+  return 1;
+}
+
+static void log_text(FILE *out, log_record_s *rec)
+{
+  fprintf(out,"%s%.*s:%u %.*s() %.*s",util_sys_log_name(rec->level),
+    rec->file_len,rec->text,rec->line,rec->func_len,rec->text+rec->file_len,rec->msg_len,rec->text+rec->file_len+rec->func_len);
+  if(rec->repeats) fprintf(out," (%u similar suppressed)",rec->repeats);
+  fputc('\n',out);
+}
+
+static void log_bin(FILE *out, log_record_s *rec)
+{
+  uint8_t head[LOG_HEADER];
+  int i;
+  for(i=0;i<8;i++) head[i] = (uint8_t)(rec->at >> (i*8));
+  for(i=0;i<4;i++) head[8+i] = (uint8_t)(rec->repeats >> (i*8));
+  head[12] = (uint8_t)rec->line;
+  head[13] = (uint8_t)(rec->line >> 8);
+  head[14] = rec->level;
+  head[15] = rec->file_len;
+  head[16] = rec->func_len;
+  head[17] = (uint8_t)rec->msg_len;
+  head[18] = (uint8_t)(rec->msg_len >> 8);
+  fwrite(head,1,LOG_HEADER,out);
+  fwrite(rec->text,1,rec->file_len+rec->func_len+rec->msg_len,out);
+}
+
+// writes every published record, returns how many
+static uint32_t log_drain(void)
+{
+  uint32_t count = 0;
+  log_slot_s *slot;
+  for(;;)
+  {
+    slot = &ring.slots[ring.tail & ring.mask];
+    if(LOAD(slot->seq) != ring.tail+1) break;
+    if(ring.text) log_text(ring.text, &slot->rec);
+    if(ring.bin) log_bin(ring.bin, &slot->rec);
+    STORE(slot->seq, ring.tail + ring.mask + 1); // free for the next lap
+    ring.tail++;
+    count++;
+  }
+
+  // note any drops since the last time, straight to the text output so it can't be dropped itself
+  uint64_t dropped = LOAD(ring.dropped);
+  if(dropped != ring.reported && ring.text)
+  {
+    fprintf(ring.text,"%s%s:%d %s() %llu log records dropped, ring full\n",util_sys_log_name(4),__FILE__,__LINE__,__func__,(unsigned long long)(dropped - ring.reported));
+    ring.reported = dropped;
+  }
+
+  if(count)
+  {
+    ADD(ring.written, count);
+    if(ring.text) fflush(ring.text);
+    if(ring.bin) fflush(ring.bin);
+  }
+  return count;
+}
+
+static void *log_writer(void *arg)
+{
+  struct timespec idle = {0, LOG_IDLE_US * 1000};
+  while(!LOAD(ring.stopping)) if(!log_drain()) nanosleep(&idle, NULL);
+  log_drain();
+  return NULL;
+}
+
+int util_log_start(uint32_t slots, FILE *text, FILE *bin)
+{
+  uint64_t i, size = 2;
+  if(LOAD(ring.running) || ring.slots || (!text && !bin)) return -1;
+  while(size < slots) size <<= 1;
+  if(!(ring.slots = malloc(size * sizeof(log_slot_s)))) return -1;
+  for(i=0;i<size;i++) ring.slots[i].seq = i;
+  ring.mask = size - 1;
+  ring.head = ring.tail = 0;
+  ring.text = text;
+  ring.bin = bin;
+  ring.written = ring.dropped = ring.suppressed = ring.reported = 0;
+  memset(ring.sites, 0, sizeof(ring.sites));
+  STORE(ring.stopping, 0);
+  if(pthread_create(&ring.thread, NULL, log_writer, NULL))
+  {
+    free(ring.slots);
+    ring.slots = NULL;
+    return -1;
+  }
+  STORE(ring.running, 1);
+  return 0;
+}
+
+void util_log_stop(void)
+{
+  if(!LOAD(ring.running)) return;
+
+  // no new producers, let the ones mid-push finish, then the writer drains what's left
+  SC_STORE(ring.running, 0);
+  while(SC_LOAD(ring.inflight)) sched_yield();
+  STORE(ring.stopping, 1);
+  pthread_join(ring.thread, NULL);
+  free(ring.slots);
+  ring.slots = NULL;
+}
+
+void util_log_burst(uint32_t per_second)
+{
+  STORE(ring.burst, per_second);
+}
+
+void util_log_stats(uint64_t *written, uint64_t *dropped, uint64_t *suppressed)
+{
+  if(written) *written = LOAD(ring.written);
+  if(dropped) *dropped = LOAD(ring.dropped);
+  if(suppressed) *suppressed = LOAD(ring.suppressed);
+}
+
+uint32_t util_log_decode(FILE *bin, FILE *text)
+{
+  uint8_t head[LOG_HEADER];
+  log_record_s rec;
+  uint32_t count = 0;
+  int i;
+  if(!bin || !text) return 0;
+  while(fread(head,1,LOG_HEADER,bin) == LOG_HEADER)
+  {
+    memset(&rec,0,sizeof(rec));
+    for(i=7;i>=0;i--) rec.at = (rec.at << 8) | head[i];
+    for(i=3;i>=0;i--) rec.repeats = (rec.repeats << 8) | head[8+i];
+    rec.line = (uint16_t)(head[12] | (head[13] << 8));
+    rec.level = head[14];
+    rec.file_len = head[15];
+    rec.func_len = head[16];
+    rec.msg_len = (uint16_t)(head[17] | (head[18] << 8));
+    if(rec.file_len > LOG_FILE || rec.func_len > LOG_FUNC || (size_t)rec.file_len+rec.func_len+rec.msg_len >= LOG_TEXT) break; // not a log
+    if(fread(rec.text,1,rec.file_len+rec.func_len+rec.msg_len,bin) != (size_t)(rec.file_len+rec.func_len+rec.msg_len)) break;
+    fprintf(text,"%llu.%06u ",(unsigned long long)(rec.at / 1000000),(unsigned)(rec.at % 1000000));
+    log_text(text, &rec);
+    count++;
+  }
+  return count;
+}
+
+#endif
@@ -7,6 +7,12 @@
 #include <sys/time.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "telehash.h"
 
@@ -23,6 +29,13 @@ unsigned long long util_sys_ms(long epoch)
   return (unsigned long long)(tv.tv_sec - epoch) * 1000 + (unsigned long long)(tv.tv_usec) / 1000;
 }
 
+uint64_t util_sys_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
 unsigned short util_sys_short(unsigned short x)
 {
   return ntohs(x);
@@ -50,12 +63,64 @@ long util_sys_random(void)
   return random();
 }
 
+int util_sys_entropy(uint8_t *bytes, size_t len)
+{
+  ssize_t got;
+  int fd;
+
+#ifdef SYS_getrandom
+  // straight from the kernel pool, blocks only until it's initialized at boot
+  while(len)
+  {
+    got = syscall(SYS_getrandom, bytes, len, 0);
+    if(got < 0 && errno == EINTR) continue;
+    if(got <= 0) break;
+    bytes += got;
+    len -= (size_t)got;
+  }
+  if(!len) return 0;
+#endif
+
+  if((fd = open("/dev/urandom", O_RDONLY)) < 0) return -1;
+  while(len)
+  {
+    got = read(fd, bytes, len);
+    if(got < 0 && errno == EINTR) continue;
+    if(got <= 0) break;
+    bytes += got;
+    len -= (size_t)got;
+  }
+  close(fd);
+  return len ? -1 : 0;
+}
+
 #ifdef DEBUG
 static int _logging = 1;
+int8_t util_sys_log_max = 8;
 #else
 static int _logging = 0;
+int8_t util_sys_log_max = -1;
 #endif
 
+// per-module overrides, set up front before any threads are logging
+#define LOG_MODULES 16
+static struct log_module_struct
+{
+  char name[16];
+  int8_t level;
+} _log_modules[LOG_MODULES];
+static uint8_t _log_nmodules = 0;
+static int8_t _log_level = 8;
+
+// recompute the single value the LOG macros check first
+static void log_max(void)
+{
+  uint8_t i;
+  int8_t max = _log_level;
+  for(i=0;i<_log_nmodules;i++) if(_log_modules[i].level > max) max = _log_modules[i].level;
+  util_sys_log_max = _logging ? max : -1;
+}
+
 void util_sys_logging(int enabled)
 {
   if(enabled < 0)
@@ -64,33 +129,77 @@ void util_sys_logging(int enabled)
   }else{
     _logging = enabled;    
   }
+  log_max();
   LOG("log output enabled");
 }
 
+void util_sys_log_level(int8_t level)
+{
+  _log_level = level;
+  log_max();
+}
+
+int util_sys_log_module(const char *module, int8_t level)
+{
+  uint8_t i;
+  if(!module || strlen(module) >= sizeof(_log_modules[0].name)) return -1;
+  for(i=0;i<_log_nmodules && strcmp(_log_modules[i].name,module);i++);
+  if(i == LOG_MODULES) return -1;
+  if(i == _log_nmodules) strcpy(_log_modules[_log_nmodules++].name,module);
+  _log_modules[i].level = level;
+  log_max();
+  return 0;
+}
+
+// a file's module is its basename without the extension
+int util_sys_log_on(uint8_t level, const char *file)
+{
+  uint8_t i;
+  size_t len;
+  const char *name;
+  if((int8_t)level > util_sys_log_max) return 0;
+  if(!_log_nmodules || !file) return (int8_t)level <= _log_level;
+  name = strrchr(file,'/');
+  name = name ? name+1 : file;
+  len = strcspn(name,".");
+  for(i=0;i<_log_nmodules;i++)
+  {
+    if(strncmp(_log_modules[i].name,name,len) == 0 && _log_modules[i].name[len] == 0) return (int8_t)level <= _log_modules[i].level;
+  }
+  return (int8_t)level <= _log_level;
+}
+
+// https://en.wikipedia.org/wiki/Syslog#Severity_level
+const char *util_sys_log_name(uint8_t level)
+{
+  switch(level)
+  {
+    case 0: return "EMERG  ";
+    case 1: return "ALERT  ";
+    case 2: return "CRIT   ";
+    case 3: return "ERROR  ";
+    case 4: return "WARN   ";
+    case 5: return "NOTICE ";
+    case 6: return "INFO   ";
+    case 7: return "DEBUG  ";
+    case 8: return "CRAZY  ";
+  }
+  return "?????? ";
+}
+
 void *util_sys_log(uint8_t level, const char *file, int line, const char *function, const char * format, ...)
 {
   char buffer[256];
   va_list args;
-  if(!_logging) return NULL;
-  // https://en.wikipedia.org/wiki/Syslog#Severity_level
-  char *lstr = NULL;
-  switch(level)
+  if((int8_t)level > util_sys_log_max) return NULL;
+  va_start (args, format);
+  // the async writer takes it when running
+  if(!util_log_vpush(level, file, line, function, format, args))
   {
-    case 0: lstr = "EMERG  "; break;
-    case 1: lstr = "ALERT  "; break;
-    case 2: lstr = "CRIT   "; break;
-    case 3: lstr = "ERROR  "; break;
-    case 4: lstr = "WARN   "; break;
-    case 5: lstr = "NOTICE "; break;
-    case 6: lstr = "INFO   "; break;
-    case 7: lstr = "DEBUG  "; break;
-    case 8: lstr = "CRAZY  "; break;
-    default: lstr = "?????? "; break;
+    vsnprintf (buffer, 256, format, args);
+    fprintf(stderr,"%s%s:%d %s() %s\n",util_sys_log_name(level),file, line, function, buffer);
+    fflush(stderr);
   }
-  va_start (args, format);
-  vsnprintf (buffer, 256, format, args);
-  fprintf(stderr,"%s%s:%d %s() %s\n",lstr,file, line, function, buffer);
-  fflush(stderr);
   va_end (args);
   return NULL;
 }
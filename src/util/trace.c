@@ -0,0 +1,142 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "telehash.h"
+
+// log-linear buckets like an HDR histogram, 16 per power of two so any value is within 1/16th,
+// exact below 16ns and everything from 2^40ns (~18 minutes) up lands in the last one
+#define TRACE_SUB 16
+#define TRACE_SHIFT 4
+#define TRACE_TOP 39
+#define TRACE_BUCKETS ((TRACE_TOP - TRACE_SHIFT + 2) * TRACE_SUB)
+
+typedef struct trace_hist_struct
+{
+  uint64_t count, sum, min, max;
+  uint64_t buckets[TRACE_BUCKETS];
+} trace_hist_s;
+
+static trace_hist_s hists[UTIL_TRACE_MAX];
+static util_trace_f trace_hook = NULL;
+static void *trace_arg = NULL;
+
+#define TRACE_NAME(name) #name,
+static const char *trace_names[] = { UTIL_TRACE_STAGES(TRACE_NAME) };
+#undef TRACE_NAME
+
+static uint32_t trace_bucket(uint64_t ns)
+{
+  uint32_t msb;
+  if(ns < TRACE_SUB) return (uint32_t)ns;
+  msb = 63 - (uint32_t)__builtin_clzll(ns);
+  if(msb > TRACE_TOP) return TRACE_BUCKETS - 1;
+  return (msb - TRACE_SHIFT + 1) * TRACE_SUB + (uint32_t)((ns >> (msb - TRACE_SHIFT)) & (TRACE_SUB - 1));
+}
+
+// largest value that lands in this bucket
+static uint64_t trace_bound(uint32_t bucket)
+{
+  uint32_t shift;
+  if(bucket < TRACE_SUB) return bucket;
+  shift = bucket / TRACE_SUB - 1;
+  return (((uint64_t)(TRACE_SUB + bucket % TRACE_SUB) + 1) << shift) - 1;
+}
+
+void util_trace_hook(util_trace_f hook, void *arg)
+{
+  trace_arg = arg;
+  trace_hook = hook;
+}
+
+void util_trace_record(util_trace_stage_t stage, uint64_t start, uint64_t ns, void *ctx)
+{
+  trace_hist_s *hist;
+  uint64_t seen;
+  util_trace_f hook;
+  if(stage >= UTIL_TRACE_MAX) return;
+
+  // any thread may record, the totals are only as consistent as their individual counters
+  hist = &hists[stage];
+  __atomic_fetch_add(&hist->buckets[trace_bucket(ns)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&hist->sum, ns, __ATOMIC_RELAXED);
+  seen = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+  while(ns > seen && !__atomic_compare_exchange_n(&hist->max, &seen, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  seen = __atomic_load_n(&hist->min, __ATOMIC_RELAXED);
+  while((!seen || ns < seen) && !__atomic_compare_exchange_n(&hist->min, &seen, ns ? ns : 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+
+  if((hook = trace_hook)) hook(stage, start, ns, ctx, trace_arg);
+}
+
+void util_trace_record_each(util_trace_stage_t stage, uint64_t start, uint64_t ns, void *ctx, uint32_t count)
+{
+  uint32_t i;
+  for(i = 0; i < count; i++) util_trace_record(stage, start, ns / count, ctx);
+}
+
+const char *util_trace_name(util_trace_stage_t stage)
+{
+  if(stage >= UTIL_TRACE_MAX) return NULL;
+  return trace_names[stage];
+}
+
+static void trace_set(lob_t json, char *key, uint64_t val)
+{
+  char num[21];
+  int len = snprintf(num, sizeof(num), "%" PRIu64, val);
+  lob_set_raw(json, key, 0, num, (size_t)len);
+}
+
+// value at or below which q/1000 of the samples fall
+static uint64_t trace_percentile(uint64_t *buckets, uint64_t total, uint64_t max, uint32_t q)
+{
+  uint64_t want = (total * q + 999) / 1000, seen = 0, bound;
+  uint32_t i;
+  for(i = 0; i < TRACE_BUCKETS; i++)
+  {
+    seen += buckets[i];
+    if(seen < want) continue;
+    bound = trace_bound(i);
+    return (bound > max) ? max : bound;
+  }
+  return max;
+}
+
+lob_t util_trace_snapshot(void)
+{
+  static const uint32_t qs[] = {500, 900, 990, 999};
+  static char *qnames[] = {"p50", "p90", "p99", "p999"};
+  uint64_t buckets[TRACE_BUCKETS];
+  uint64_t total, max;
+  uint32_t stage, i;
+  lob_t json, one;
+
+  if(!(json = lob_new())) return LOG("OOM");
+  lob_head(json, (uint8_t*)"{}", 2);
+  for(stage = 0; stage < UTIL_TRACE_MAX; stage++)
+  {
+    // copy the buckets first so the percentiles agree with each other
+    total = 0;
+    for(i = 0; i < TRACE_BUCKETS; i++) total += (buckets[i] = __atomic_load_n(&hists[stage].buckets[i], __ATOMIC_RELAXED));
+    if(!total) continue;
+    max = __atomic_load_n(&hists[stage].max, __ATOMIC_RELAXED);
+
+    if(!(one = lob_new())) break;
+    trace_set(one, "count", total);
+    trace_set(one, "min", __atomic_load_n(&hists[stage].min, __ATOMIC_RELAXED));
+    trace_set(one, "max", max);
+    trace_set(one, "mean", __atomic_load_n(&hists[stage].sum, __ATOMIC_RELAXED) / total);
+    for(i = 0; i < sizeof(qs)/sizeof(qs[0]); i++) trace_set(one, qnames[i], trace_percentile(buckets, total, max, qs[i]));
+    lob_set_raw(json, (char*)trace_names[stage], 0, (char*)one->head, one->head_len);
+    lob_free(one);
+  }
+
+  return json;
+}
+
+void util_trace_reset(void)
+{
+  memset(hists, 0, sizeof(hists));
+}
@@ -4,18 +4,112 @@
 #include <stdlib.h>
 #include "telehash.h"
 
+// 16 bytes / 32 hex chars at a time with vector lookups when the CPU has them, util_unhex only takes the
+// fast path for blocks of clean digits so its lenient handling of anything else is unchanged, define
+// UTIL_HEX_NO_ACCEL to build only the byte loops
+
+#if !defined(UTIL_HEX_NO_ACCEL) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define UTIL_HEX_SSSE3
+#include <tmmintrin.h>
+
+__attribute__((target("ssse3")))
+static void hex_block(const uint8_t *in, char *out)
+{
+  __m128i x = _mm_loadu_si128((const __m128i *)in);
+  __m128i digits = _mm_setr_epi8('0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f');
+  __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi8(0x0F)));
+  __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(x, _mm_set1_epi8(0x0F)));
+  _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi8(hi, lo));
+  _mm_storeu_si128((__m128i *)(out+16), _mm_unpackhi_epi8(hi, lo));
+}
+
+// nibble values of 16 chars, valid is cleared unless all are 0-9 a-f A-F
+__attribute__((target("ssse3")))
+static __m128i unhex_nibbles(__m128i c, int *valid)
+{
+  __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0'-1)), _mm_cmpgt_epi8(_mm_set1_epi8('9'+1), c));
+  __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a'-1)), _mm_cmpgt_epi8(_mm_set1_epi8('f'+1), lower));
+  if(_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xFFFF) *valid = 0;
+  return _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))), _mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a'-10))));
+}
+
+__attribute__((target("ssse3")))
+static int unhex_block(const char *in, uint8_t *out)
+{
+  int valid = 1;
+  __m128i a = unhex_nibbles(_mm_loadu_si128((const __m128i *)in), &valid);
+  __m128i b = unhex_nibbles(_mm_loadu_si128((const __m128i *)(in+16)), &valid);
+  if(!valid) return 0;
+  a = _mm_maddubs_epi16(a, _mm_set1_epi16(0x0110));
+  b = _mm_maddubs_epi16(b, _mm_set1_epi16(0x0110));
+  _mm_storeu_si128((__m128i *)out, _mm_packus_epi16(a, b));
+  return 1;
+}
+
+#endif // UTIL_HEX_SSSE3
+
+#if !defined(UTIL_HEX_NO_ACCEL) && !defined(UTIL_HEX_SSSE3) && defined(__aarch64__) && defined(__ARM_NEON)
+#define UTIL_HEX_NEON
+#include <arm_neon.h>
+
+static void hex_block(const uint8_t *in, char *out)
+{
+  static const uint8_t table[16] = "0123456789abcdef";
+  uint8x16_t digits = vld1q_u8(table);
+  uint8x16_t x = vld1q_u8(in);
+  uint8x16x2_t r;
+  r.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(x, 4));
+  r.val[1] = vqtbl1q_u8(digits, vandq_u8(x, vdupq_n_u8(0x0F)));
+  vst2q_u8((uint8_t *)out, r);
+}
+
+static uint8x16_t unhex_nibbles(uint8x16_t c, uint8x16_t *valid)
+{
+  uint8x16_t lower = vorrq_u8(c, vdupq_n_u8(0x20));
+  uint8x16_t digit = vcleq_u8(vsubq_u8(c, vdupq_n_u8('0')), vdupq_n_u8(9));
+  uint8x16_t alpha = vcleq_u8(vsubq_u8(lower, vdupq_n_u8('a')), vdupq_n_u8(5));
+  *valid = vandq_u8(*valid, vorrq_u8(digit, alpha));
+  return vbslq_u8(digit, vsubq_u8(c, vdupq_n_u8('0')), vsubq_u8(lower, vdupq_n_u8('a'-10)));
+}
+
+static int unhex_block(const char *in, uint8_t *out)
+{
+  uint8x16x2_t c = vld2q_u8((const uint8_t *)in);
+  uint8x16_t valid = vdupq_n_u8(0xFF);
+  uint8x16_t hi = unhex_nibbles(c.val[0], &valid);
+  uint8x16_t lo = unhex_nibbles(c.val[1], &valid);
+  if(vminvq_u8(valid) != 0xFF) return 0;
+  vst1q_u8(out, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+  return 1;
+}
+
+#endif // UTIL_HEX_NEON
+
+#if defined(UTIL_HEX_SSSE3)
+#define HEX_ACCEL() __builtin_cpu_supports("ssse3")
+#elif defined(UTIL_HEX_NEON)
+#define HEX_ACCEL() 1
+#else
+#define HEX_ACCEL() 0
+#define hex_block(in,out) do{}while(0)
+#define unhex_block(in,out) 0
+#endif
+
 char *util_hex(uint8_t *in, size_t len, char *out)
 {
     uint32_t j;
     char *c = out;
     static char *hex = "0123456789abcdef";
-    static char *buf = NULL;
+    static UTIL_TLS char *buf = NULL;
     if(!in || !len) return NULL;
 
     // utility mode only! use/return an internal buffer
     if(!out && !(c = out = buf = realloc(buf,len*2+1))) return NULL;
 
-    for (j = 0; j < len; j++) {
+    j = 0;
+    if(HEX_ACCEL()) for(;len - j >= 16;j += 16, c += 32) hex_block(in+j, c);
+    for (; j < len; j++) {
       *c = hex[((in[j]&240)/16)];
       c++;
       *c = hex[in[j]&15];
@@ -45,7 +139,9 @@ uint8_t *util_unhex(char *in, size_t len, uint8_t *out)
   if(!out || !in) return NULL;
   if(!len) len = strlen(in);
 
-  for(j=0; (j+1)<len; j+=2)
+  j = 0;
+  if(HEX_ACCEL()) for(;len - j >= 32 && unhex_block(in+j, c);j += 32, c += 16);
+  for(; (j+1)<len; j+=2)
   {
     *c = ((hexcode(in[j]) * 16) & 0xF0) + (hexcode(in[j+1]) & 0xF);
     c++;
@@ -44,6 +44,117 @@ int main(int argc, char **argv)
   fail_unless(lob_get_int(outgoing,"c") == 1);
   lob_set_int(outgoing,"test",42);
   fail_unless(!chan_send(chan,outgoing)); // dropped, no link
+  chan_free(chan);
+
+  // an open with a seq is reliable, delivery is in order and only once
+  lob_set_uint(open,"seq",1);
+  chan = chan_new(open);
+  fail_unless(chan);
+  fail_unless(chan->window == CHAN_WINDOW);
+  fail_unless(chan_receive(chan,lob_copy(open)));
+  uint32_t seqs[] = {3, 2, 2, 6, 5, 1, 4 + CHAN_WINDOW};
+  for(int i = 0; i < 7; i++)
+  {
+    incoming = lob_new();
+    lob_set_uint(incoming,"c",1);
+    lob_set_uint(incoming,"seq",seqs[i]);
+    fail_unless(chan_receive(chan,incoming));
+  }
+  for(int i = 1; i <= 3; i++)
+  {
+    incoming = chan_receiving(chan);
+    fail_unless(lob_get_uint(incoming,"seq") == (unsigned)i);
+    lob_free(incoming);
+  }
+  fail_unless(chan_receiving(chan) == NULL);
+  fail_unless(chan->ack == 3 && chan->seen == 6);
+
+  // the ack says what's missing as offsets from it
+  lob_t ack = chan_oob(chan);
+  fail_unless(lob_get_uint(ack,"ack") == 3);
+  fail_unless(lob_get_cmp(ack,"miss","[1]") == 0);
+  lob_free(ack);
+
+  // filling the gap hands over the rest
+  incoming = lob_new();
+  lob_set_uint(incoming,"c",1);
+  lob_set_uint(incoming,"seq",4);
+  fail_unless(chan_receive(chan,incoming));
+  for(int i = 4; i <= 6; i++)
+  {
+    incoming = chan_receiving(chan);
+    fail_unless(lob_get_uint(incoming,"seq") == (unsigned)i);
+    lob_free(incoming);
+  }
+  ack = chan_oob(chan);
+  fail_unless(lob_get_uint(ack,"ack") == 6);
+  fail_unless(!lob_get(ack,"miss"));
+  lob_free(ack);
+
+  // seqs are given as packets are sent, so one that's refused leaves no gap, and a bare ack is never handed over
+  outgoing = chan_packet(chan);
+  fail_unless(!lob_get(outgoing,"seq"));
+  lob_free(outgoing);
+  fail_unless(chan_writable(chan) == CHAN_WINDOW * 2);
+  incoming = lob_new();
+  lob_set_uint(incoming,"c",1);
+  lob_set_uint(incoming,"ack",0);
+  fail_unless(chan_receive(chan,incoming));
+  fail_unless(chan_receiving(chan) == NULL);
+
+  // acks only count up to what's gone out, not what's still queued behind the window
+  chan->seq = 4;
+  chan->last = 1;
+  incoming = lob_new();
+  lob_set_uint(incoming,"c",1);
+  lob_set_uint(incoming,"ack",3);
+  fail_unless(chan_receive(chan,incoming));
+  fail_unless(chan->acked == 0);
+  incoming = lob_new();
+  lob_set_uint(incoming,"c",1);
+  lob_set_uint(incoming,"ack",1);
+  fail_unless(chan_receive(chan,incoming));
+  fail_unless(chan->acked == 1);
+
+  // a full buffer holds the rest back unacked and says there's no room, reading opens it again
+  fail_unless(chan_buffer(chan,2) == 2);
+  for(int i = 7; i <= 10; i++)
+  {
+    incoming = lob_new();
+    lob_set_uint(incoming,"c",1);
+    lob_set_uint(incoming,"seq",i);
+    fail_unless(chan_receive(chan,incoming));
+  }
+  fail_unless(chan_readable(chan) == 2);
+  ack = chan_oob(chan);
+  fail_unless(lob_get_uint(ack,"ack") == 8);
+  fail_unless(lob_get_uint(ack,"win") == 0);
+  lob_free(ack);
+  chan->acking = 0;
+  lob_free(chan_receiving(chan));
+  fail_unless(chan->acking);
+  fail_unless(chan_readable(chan) == 2 && chan->ack == 9);
+  lob_free(chan_receiving(chan));
+  lob_free(chan_receiving(chan));
+  fail_unless(chan_readable(chan) == 1 && chan->ack == 10);
+  ack = chan_oob(chan);
+  fail_unless(lob_get_uint(ack,"win") == 1);
+  lob_free(ack);
+  chan_free(chan);
+
+  // unreliable ones drop past a full buffer
+  lob_free(open);
+  open = lob_new();
+  lob_set(open,"type","bulk");
+  lob_set_uint(open,"c",2);
+  chan = chan_new(open);
+  fail_unless(!chan->window && chan_writable(chan) == 1);
+  chan_buffer(chan,1);
+  fail_unless(chan_receive(chan,lob_new()));
+  fail_unless(!chan_receive(chan,lob_new()));
+  fail_unless(chan_readable(chan) == 1);
+  chan_free(chan);
+  lob_free(open);
 
   return 0;
 }
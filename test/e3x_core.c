@@ -1,6 +1,8 @@
 #include "e3x.h"
 #include "util.h"
 #include "unit_test.h"
+#include <unistd.h>
+#include <sys/wait.h>
 
 int main(int argc, char **argv)
 {
@@ -9,6 +11,51 @@ int main(int argc, char **argv)
   fail_unless(!lob_get(opts,"err"));
   fail_unless(!e3x_err());
   lob_free(opts);
+
+  // small requests come out of the buffer, never repeating
+  uint8_t a[32], b[32], zero[32];
+  memset(zero,0,32);
+  fail_unless(e3x_rand(a,32) == a);
+  fail_unless(e3x_rand(b,32) == b);
+  fail_unless(memcmp(a,b,32) != 0);
+  fail_unless(memcmp(a,zero,32) != 0);
+
+  // bulk requests bypass it, every byte value should turn up
+  size_t i, len = 256*1024;
+  uint32_t counts[256];
+  uint8_t *bulk = malloc(len);
+  fail_unless(e3x_rand(bulk,len) == bulk);
+  memset(counts,0,sizeof(counts));
+  for(i=0;i<len;i++) counts[bulk[i]]++;
+  uint32_t off = 0;
+  for(i=0;i<256;i++) if(counts[i] < 512 || counts[i] > 1536) off++;
+  fail_unless(off == 0);
+  fail_unless(memcmp(bulk,bulk+len-32,32) != 0);
+  free(bulk);
+
+  // crossing a buffer refill
+  uint8_t odd[1000];
+  for(i=0;i<5;i++) fail_unless(e3x_rand(odd,sizeof(odd)));
+  fail_unless(memcmp(odd,odd+500,32) != 0);
+
+  // a forked child reseeds instead of replaying the parent's buffered keystream
+  int fds[2];
+  uint8_t mine[32], theirs[32];
+  fail_unless(pipe(fds) == 0);
+  pid_t child = fork();
+  fail_unless(child >= 0);
+  if(child == 0)
+  {
+    e3x_rand(mine,32);
+    _exit(write(fds[1],mine,32) == 32 ? 0 : 1);
+  }
+  e3x_rand(mine,32);
+  fail_unless(read(fds[0],theirs,32) == 32);
+  fail_unless(waitpid(child,NULL,0) == child);
+  fail_unless(memcmp(mine,theirs,32) != 0);
+  close(fds[0]);
+  close(fds[1]);
+
   return 0;
 }
 
@@ -2,6 +2,7 @@
 #include "util.h"
 #include "unit_test.h"
 #include "util_sys.h"
+#include "uECC.h"
 
 // fixtures
 #define A_KEY "ankhb3ue7pnplgcf4aedcdzolk7uwq5i42dyt25fj7e52vi4ujdfk";
@@ -32,6 +33,23 @@ int main(int argc, char **argv)
   util_hex(e3x_hash((uint8_t*)"",0,buf),32,hex);
   fail_unless(strcmp(hex,"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855") == 0);
 
+  // the fixture secrets must give back their keys, exercises the native field arithmetic
+  uint8_t secret[32], point[64], comp[33], fixed[33];
+  char *fix_sec[2], *fix_key[2];
+  fix_sec[0] = A_SEC
+  fix_key[0] = A_KEY
+  fix_sec[1] = B_SEC
+  fix_key[1] = B_KEY
+  int f;
+  for(f=0;f<2;f++)
+  {
+    fail_unless(base32_decode(fix_sec[f],0,secret,sizeof(secret)) == 32);
+    fail_unless(base32_decode(fix_key[f],0,fixed,sizeof(fixed)) == 33);
+    fail_unless(uECC_compute_public_key(secret,point,uECC_secp256r1()));
+    uECC_compress(point,comp,uECC_secp256r1());
+    fail_unless(memcmp(comp,fixed,33) == 0);
+  }
+
   lob_t secrets = e3x_generate();
   fail_unless(secrets);
   fail_unless(lob_get(secrets,"1c"));
@@ -95,6 +95,33 @@ int main(int argc, char **argv)
   lob_free(cinAB);
   lob_free(coutAB);
 
+  // batch of channel packets
+  lob_t batch = NULL, outers, cout;
+  int i;
+  for(i=0;i<11;i++)
+  {
+    lob_t p = lob_new();
+    lob_set_int(p,"c",lob_get_int(chanAB,"c"));
+    lob_set_int(p,"seq",i);
+    lob_body(p,NULL,i*50);
+    batch = lob_push(batch,p);
+  }
+  outers = e3x_exchange_send_batch(xAB,batch);
+  fail_unless(outers);
+  for(i=0,cout=outers;cout;cout=lob_next(cout),i++)
+  {
+    lob_t copy = lob_copy(cout);
+    cinAB = e3x_exchange_receive(xBA,copy);
+    lob_free(copy);
+    fail_unless(cinAB);
+    fail_unless(lob_get_int(cinAB,"seq") == i);
+    fail_unless(lob_body_len(cinAB) == (size_t)i*50);
+    lob_free(cinAB);
+  }
+  fail_unless(i == 11);
+  lob_freeall(outers);
+  lob_freeall(batch);
+
   e3x_exchange_free(xAB);
   e3x_exchange_free(xBA);
   e3x_self_free(selfA);
@@ -1,6 +1,61 @@
 #include "base32.h"
 #include "unit_test.h"
 
+// the plain byte loops, the vector blocks must give identical results
+static size_t ref_decode(const char *encoded, size_t length, uint8_t *result, size_t bufSize)
+{
+  int buffer = 0;
+  size_t bitsLeft = 0, count = 0;
+  const char *ptr;
+  if(!length) length = strlen(encoded);
+  for(ptr = encoded; (size_t)(ptr-encoded) < length && count < bufSize; ++ptr)
+  {
+    uint8_t ch = (uint8_t)*ptr;
+    if(ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '-') continue;
+    buffer <<= 5;
+    if(ch == '0') ch = 'O';
+    else if(ch == '1') ch = 'L';
+    else if(ch == '8') ch = 'B';
+    if((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z')) ch = (ch & 0x1F) - 1;
+    else if(ch >= '2' && ch <= '7') ch -= '2' - 26;
+    else return 0;
+    buffer |= ch;
+    bitsLeft += 5;
+    if(bitsLeft >= 8)
+    {
+      result[count++] = buffer >> (bitsLeft - 8);
+      bitsLeft -= 8;
+    }
+  }
+  if(count < bufSize) result[count] = 0;
+  return count;
+}
+
+static size_t ref_encode(const uint8_t *data, size_t length, char *result, size_t bufSize)
+{
+  size_t count = 0, next = 1;
+  int buffer = data[0], bitsLeft = 8;
+  while(count < bufSize && (bitsLeft > 0 || next < length))
+  {
+    if(bitsLeft < 5)
+    {
+      if(next < length)
+      {
+        buffer <<= 8;
+        buffer |= data[next++] & 0xFF;
+        bitsLeft += 8;
+      }else{
+        buffer <<= 5 - bitsLeft;
+        bitsLeft = 5;
+      }
+    }
+    result[count++] = "abcdefghijklmnopqrstuvwxyz234567"[0x1F & (buffer >> (bitsLeft - 5))];
+    bitsLeft -= 5;
+  }
+  if(count < bufSize) result[count] = 0;
+  return count;
+}
+
 int main(int argc, char **argv)
 {
     const char *str = "foo bar";
@@ -23,6 +78,37 @@ int main(int argc, char **argv)
     void *data2 = malloc(outlen);
     fail_unless(base32_decode(b, 0, data2, outlen) == outlen);
 
+    // every length across several blocks, and every byte value at every position of a clean string
+    size_t bad = 0;
+    uint8_t raw[128], got[128], want[128];
+    char enc[256], enc2[256];
+    size_t i, j, n, bufs[] = {1, 9, 10, 11, 16, 17, 100, 200};
+    srand(42);
+    for(i = 0; i < sizeof(raw); i++) raw[i] = rand();
+    for(n = 1; n <= 100; n++) for(j = 0; j < sizeof(bufs)/sizeof(size_t); j++)
+    {
+      memset(enc, 'x', sizeof(enc));
+      memset(enc2, 'x', sizeof(enc2));
+      if(base32_encode(raw, n, enc, bufs[j]) != ref_encode(raw, n, enc2, bufs[j])) bad++;
+      if(memcmp(enc, enc2, sizeof(enc)) != 0) bad++;
+      ref_encode(raw, n, enc2, sizeof(enc2));
+      memset(got, 0xAA, sizeof(got));
+      memset(want, 0xAA, sizeof(want));
+      if(base32_decode(enc2, 0, got, bufs[j]) != ref_decode(enc2, 0, want, bufs[j])) bad++;
+      if(memcmp(got, want, sizeof(got)) != 0) bad++;
+    }
+    n = ref_encode(raw, 60, enc2, sizeof(enc2));
+    for(i = 0; i < 48; i++) for(j = 1; j < 256; j++)
+    {
+      memcpy(enc, enc2, n+1);
+      enc[i] = j;
+      memset(got, 0xAA, sizeof(got));
+      memset(want, 0xAA, sizeof(want));
+      if(base32_decode(enc, n, got, sizeof(got)) != ref_decode(enc, n, want, sizeof(want))) bad++;
+      if(memcmp(got, want, sizeof(got)) != 0) bad++;
+    }
+    fail_unless(bad == 0);
+
     return 0;
 }
 
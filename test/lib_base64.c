@@ -12,6 +12,49 @@ BASE64("") = ""
    BASE64("foobar") = "Zm9vYmFy"
 */
 
+// the plain byte loops, the vector blocks must give identical results
+static size_t ref_decoder(const char *str, size_t len, uint8_t *out)
+{
+  static const char *alpha = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+  uint8_t *start = out;
+  int d, dlast = 0, phase = 0;
+  if(!len) len = strlen(str);
+  if((len % 4) == 1) return 0;
+  for(; *str && len; str++, len--)
+  {
+    if(*str == '+' || *str == '-') d = 62;
+    else if(*str == '/' || *str == '_') d = 63;
+    else if(strchr(alpha, *str)) d = strchr(alpha, *str) - alpha;
+    else return 0;
+    if(phase == 1) *out++ = (dlast << 2) | ((d & 0x30) >> 4);
+    if(phase == 2) *out++ = ((dlast & 0xf) << 4) | ((d & 0x3c) >> 2);
+    if(phase == 3) *out++ = ((dlast & 0x03) << 6) | d;
+    phase = (phase + 1) % 4;
+    dlast = d;
+  }
+  return out - start;
+}
+
+static size_t ref_encoder(const uint8_t *str, size_t len, char *out)
+{
+  static const char *table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  size_t i, count = 0;
+  for(i = 0; i < len; i++)
+  {
+    uint32_t bits = str[i] << 16;
+    if(i+1 < len) bits |= str[i+1] << 8;
+    if(i+2 < len) bits |= str[i+2];
+    out[count++] = table[(bits >> 18) & 63];
+    out[count++] = table[(bits >> 12) & 63];
+    out[count++] = (i+1 < len) ? table[(bits >> 6) & 63] : '=';
+    out[count++] = (i+2 < len) ? table[bits & 63] : '=';
+    i += 2;
+  }
+  out[count] = 0;
+  while(count && out[count-1] == '=') count--;
+  return count;
+}
+
 int main(int argc, char **argv)
 {
   char *eout = malloc(base64_encode_length(7));
@@ -53,7 +96,37 @@ int main(int argc, char **argv)
 //    printf("%s\n%s\n",rtest,rtest2);
     fail_unless(memcmp(rand,rand2,i) == 0);
   }
-  
+
+  // every length across several blocks, and every byte value at every position of a clean string
+  size_t bad = 0;
+  uint8_t raw[160], got[160], want[160];
+  char enc[256], enc2[256];
+  size_t n, j;
+  e3x_rand(raw, sizeof(raw));
+  for(n = 1; n <= 150; n++)
+  {
+    memset(enc, 'x', sizeof(enc));
+    memset(enc2, 'x', sizeof(enc2));
+    if(base64_encoder(raw, n, enc) != ref_encoder(raw, n, enc2)) bad++;
+    if(memcmp(enc, enc2, sizeof(enc)) != 0) bad++;
+    memset(got, 0xAA, sizeof(got));
+    memset(want, 0xAA, sizeof(want));
+    if(base64_decoder(enc2, 0, got) != ref_decoder(enc2, 0, want)) bad++;
+    if(memcmp(got, want, sizeof(got)) != 0) bad++;
+    if(base64_decoder(enc2, 0, NULL) != ref_decoder(enc2, 0, want)) bad++;
+  }
+  n = ref_encoder(raw, 96, enc2);
+  for(i = 0; i < 68; i++) for(j = 0; j < 256; j++)
+  {
+    memcpy(enc, enc2, n+1);
+    enc[i] = j;
+    memset(got, 0xAA, sizeof(got));
+    memset(want, 0xAA, sizeof(want));
+    if(base64_decoder(enc, n, got) != ref_decoder(enc, n, want)) bad++;
+    if(memcmp(got, want, sizeof(got)) != 0) bad++;
+  }
+  fail_unless(bad == 0);
+
   return 0;
 }
 
@@ -43,6 +43,40 @@ int main(int argc, char **argv)
   fail_unless(hashname_isshort(hn));
   fail_unless(util_cmp(hashname_short(hn),"uvabrvfq") == 0);
 
+  // encoded strings stay with their hashname
+  hashname_t a = hashname_dup(hashname_vchar("jvdoio6kjvf3yqnxfvck43twaibbg4pmb7y3mqnvxafb26rqllwa"));
+  hashname_t b = hashname_dup(hashname_schar("uvabrvfq"));
+  char *astr = hashname_char(a);
+  char *ashort = hashname_short(a);
+  fail_unless(hashname_short(b) != ashort);
+  fail_unless(hashname_char(a) == astr);
+  fail_unless(util_cmp(astr,"jvdoio6kjvf3yqnxfvck43twaibbg4pmb7y3mqnvxafb26rqllwa") == 0);
+  fail_unless(util_cmp(ashort,"jvdoio6k") == 0);
+  fail_unless(util_cmp(hashname_short(b),"uvabrvfq") == 0);
+  hashname_t c = hashname_dup(a);
+  fail_unless(util_cmp(hashname_char(c),astr) == 0);
+  hashname_free(a);
+  hashname_free(b);
+  hashname_free(c);
+
+  // the temporary is re-encoded when reused
+  fail_unless(util_cmp(hashname_char(hashname_vchar("jvdoio6kjvf3yqnxfvck43twaibbg4pmb7y3mqnvxafb26rqllwa")),"jvdoio6kjvf3yqnxfvck43twaibbg4pmb7y3mqnvxafb26rqllwa") == 0);
+  fail_unless(util_cmp(hashname_short(hashname_sbin((uint8_t*)"\0\0\0\0\0")),"aaaaaaaa") == 0);
+  fail_unless(util_cmp(hashname_char(hashname_schar("uvabrvfq")),"jvdoio6kjvf3yqnxfvck43twaibbg4pmb7y3mqnvxafb26rqllwa") != 0);
+
+  // reentrant versions fill in the caller's copy and leave the temporary alone
+  struct hashname_struct mine, mine2;
+  hn = hashname_vchar("jvdoio6kjvf3yqnxfvck43twaibbg4pmb7y3mqnvxafb26rqllwa");
+  fail_unless(hashname_schar_r("uvabrvfq",&mine) == &mine);
+  fail_unless(hashname_vkeys_r(keys,&mine2) == &mine2);
+  fail_unless(util_cmp(hashname_short(&mine),"uvabrvfq") == 0);
+  fail_unless(util_cmp(hashname_char(&mine2),"jvdoio6kjvf3yqnxfvck43twaibbg4pmb7y3mqnvxafb26rqllwa") == 0);
+  fail_unless(hashname_cmp(hn,&mine2) == 0);
+  fail_unless(hashname_sbin_r(mine2.bin,&mine2) == &mine2);
+  fail_unless(util_cmp(hashname_char(&mine2),"jvdoio6kaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa") == 0);
+  fail_unless(!hashname_vchar_r(NULL,&mine));
+  fail_unless(!hashname_vbin_r(mine.bin,NULL));
+
   return 0;
 }
 
@@ -117,6 +117,27 @@ int main(int argc, char **argv)
   lob_set_bool(truth,"true",false);
   fail_unless(!lob_get_bool(truth,"true"));
 
+  // taking over another lob's buffer
+  lob_t holder = lob_new();
+  lob_t src = lob_new();
+  lob_set(src,"take","me");
+  lob_body(src,(uint8_t*)"body",4);
+  lob_body(holder,lob_raw(src),lob_len(src));
+  lob_append(holder,(uint8_t*)"junk",4);
+  memmove(lob_raw(holder),lob_body_get(holder),lob_len(src));
+  uint8_t *held = lob_raw(holder);
+  lob_t taken = lob_take(holder,lob_len(src));
+  fail_unless(taken);
+  fail_unless(lob_raw(taken) == held);
+  fail_unless(lob_get_cmp(taken,"take","me") == 0);
+  fail_unless(lob_body_len(taken) == 4);
+  fail_unless(!lob_raw(holder));
+  fail_unless(lob_len(holder) == 2);
+  fail_unless(!lob_take(holder,2));
+  lob_free(holder);
+  lob_free(taken);
+  lob_free(src);
+
   return 0;
 }
 
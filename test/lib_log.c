@@ -0,0 +1,67 @@
+#include <pthread.h>
+#include "util.h"
+#include "unit_test.h"
+
+static void *burst_thread(void *arg)
+{
+  int i;
+  for(i = 0; i < 1000; i++) LOG_INFO("thread %p record %d",arg,i);
+  return NULL;
+}
+
+int main(int argc, char **argv)
+{
+  FILE *text = tmpfile();
+  FILE *bin = tmpfile();
+  FILE *decoded = tmpfile();
+  char line[512], expect[128];
+  uint64_t written, dropped, suppressed;
+  int i, lines;
+
+  // records come out the same as the synchronous lines, and the binary copy decodes to match
+  fail_unless(util_log_start(64, text, bin) == 0);
+  fail_unless(util_log_start(64, text, bin) != 0);
+  int at = __LINE__ + 1;
+  LOG_WARN("first %d",1);
+  LOG_INFO("second %s","two");
+  util_log_stop();
+  util_log_stats(&written, &dropped, &suppressed);
+  fail_unless(written == 2 && dropped == 0 && suppressed == 0);
+  rewind(text);
+  fail_unless(fgets(line, sizeof(line), text));
+  snprintf(expect, sizeof(expect), "WARN   lib_log.c:%d main() first 1\n", at);
+  fail_unless(strcmp(line,expect) == 0);
+  fail_unless(fgets(line, sizeof(line), text));
+  fail_unless(strstr(line,"main() second two"));
+  rewind(bin);
+  fail_unless(util_log_decode(bin, decoded) == 2);
+  rewind(decoded);
+  fail_unless(fgets(line, sizeof(line), decoded));
+  fail_unless(strstr(line,expect) && line[0] != 'W');
+
+  // one busy call site is held to the burst, the next record through says how many were held back
+  util_log_burst(5);
+  fail_unless(util_log_start(256, text, NULL) == 0);
+  for(i = 0; i < 100; i++) LOG_DEBUG("repeat %d",i);
+  util_log_stop();
+  util_log_stats(&written, &dropped, &suppressed);
+  fail_unless(written <= 10 && dropped == 0);
+  fail_unless(written + suppressed == 100);
+
+  // a tiny ring under several threads drops instead of blocking, and everything is accounted for
+  util_log_burst(0);
+  text = freopen(NULL, "w+", text);
+  fail_unless(util_log_start(2, text, NULL) == 0);
+  pthread_t threads[4];
+  for(i = 0; i < 4; i++) pthread_create(&threads[i], NULL, burst_thread, (void*)(intptr_t)i);
+  for(i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+  util_log_stop();
+  util_log_stats(&written, &dropped, &suppressed);
+  fail_unless(written + dropped == 4000);
+  fail_unless(suppressed == 0);
+  rewind(text);
+  for(lines = 0; fgets(line, sizeof(line), text); lines++);
+  fail_unless((uint64_t)lines >= written);
+
+  return 0;
+}
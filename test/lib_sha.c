@@ -16,5 +16,73 @@ int main(int argc, char **argv)
   util_hex(hash,42,hex);
   fail_unless(strcmp(hex,"8dfce091422811f95e509909ddab00bdb60668837e0400ec01170d8216fbe501bec33b8762338e927fa1") == 0);
 
+  // every back-end must match the portable one across block boundaries
+  uint8_t msg[300], ref[300][32], got[32];
+  const uint8_t *ins[300];
+  size_t lens[300];
+  uint8_t *outs[300];
+  int i;
+  for(i=0;i<300;i++) msg[i] = (uint8_t)(i*7+3);
+  char *active = sha256_backend(NULL);
+  fail_unless(active);
+  fail_unless(util_cmp(sha256_backend("generic"),"generic") == 0);
+  for(i=0;i<300;i++) sha256(msg,i,ref[i],0);
+  char *backends[] = {"shani","armv8","avx2",NULL};
+  uint8_t have[] = {0,0,0};
+#if !defined(SHA256_NO_ACCEL) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  have[0] = __builtin_cpu_supports("sha") ? 1 : 0;
+  have[2] = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+#if !defined(SHA256_NO_ACCEL) && defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+  have[1] = 1;
+#endif
+  int b;
+  for(b=0;backends[b];b++)
+  {
+    // each has to really be the one asked for, one this cpu doesn't have falls back and there's nothing new to check
+    char *picked = sha256_backend(backends[b]);
+    if(!have[b])
+    {
+      fail_unless(util_cmp(picked,"generic") == 0);
+      LOG("skipping sha256 back-end %s, not on this cpu",backends[b]);
+      continue;
+    }
+    fail_unless(util_cmp(picked,backends[b]) == 0);
+    for(i=0;i<300;i++)
+    {
+      sha256(msg,i,got,0);
+      fail_unless(memcmp(got,ref[i],32) == 0);
+    }
+    for(i=0;i<300;i++)
+    {
+      ins[i] = msg;
+      lens[i] = i;
+    }
+    uint8_t multi[300][32];
+    for(i=0;i<300;i++) outs[i] = multi[i];
+    sha256_multi(ins,lens,outs,300);
+    for(i=0;i<300;i++) fail_unless(memcmp(multi[i],ref[i],32) == 0);
+
+    // hmac batches w/ short and hashed keys
+    const uint8_t *keys[20];
+    size_t klens[20];
+    for(i=0;i<20;i++)
+    {
+      keys[i] = msg+i;
+      klens[i] = i*5;
+      ins[i] = msg+20;
+      lens[i] = i*13;
+    }
+    hmac_256_multi(keys,klens,ins,lens,outs,20);
+    for(i=0;i<20;i++)
+    {
+      hmac_256(keys[i],klens[i],ins[i],lens[i],got);
+      fail_unless(memcmp(multi[i],got,32) == 0);
+    }
+  }
+  sha256_backend(active);
+  fail_unless(util_cmp(sha256_backend(NULL),active) == 0);
+
   return 0;
 }
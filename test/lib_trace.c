@@ -0,0 +1,114 @@
+#include "net_loopback.h"
+#include "unit_test.h"
+
+static uint32_t hooked[UTIL_TRACE_MAX];
+
+static void trace_count(util_trace_stage_t stage, uint64_t start, uint64_t ns, void *ctx, void *arg)
+{
+  hooked[stage]++;
+  *(uint32_t*)arg += 1;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t calls = 0;
+  int i;
+  lob_t snap, one;
+
+  fail_unless(util_trace_name(UTIL_TRACE_mesh_receive));
+  fail_unless(strcmp(util_trace_name(UTIL_TRACE_transport),"transport") == 0);
+  fail_unless(!util_trace_name(UTIL_TRACE_MAX));
+
+  // nothing recorded has nothing to show
+  util_trace_reset();
+  snap = util_trace_snapshot();
+  fail_unless(snap);
+  fail_unless(lob_keys(snap) == 0);
+  lob_free(snap);
+
+  // 1..1000ns evenly, percentiles are within a bucket of the true value
+  util_trace_hook(trace_count, &calls);
+  for(i = 1; i <= 1000; i++) util_trace_record(UTIL_TRACE_lob_parse, 0, (uint64_t)i, NULL);
+  fail_unless(calls == 1000);
+  fail_unless(hooked[UTIL_TRACE_lob_parse] == 1000);
+  snap = util_trace_snapshot();
+  fail_unless(lob_keys(snap) == 1);
+  one = lob_get_json(snap,"lob_parse");
+  fail_unless(one);
+  fail_unless(lob_get_uint(one,"count") == 1000);
+  fail_unless(lob_get_uint(one,"min") == 1);
+  fail_unless(lob_get_uint(one,"max") == 1000);
+  fail_unless(lob_get_uint(one,"mean") == 500);
+  fail_unless(lob_get_uint(one,"p50") >= 500 && lob_get_uint(one,"p50") <= 500 + 500/16);
+  fail_unless(lob_get_uint(one,"p99") >= 990 && lob_get_uint(one,"p99") <= 1000);
+  fail_unless(lob_get_uint(one,"p999") == 1000);
+  lob_free(one);
+  lob_free(snap);
+
+  // huge values stay in range
+  util_trace_record(UTIL_TRACE_lob_parse, 0, UINT64_MAX, NULL);
+  snap = util_trace_snapshot();
+  one = lob_get_json(snap,"lob_parse");
+  fail_unless(lob_get_uint(one,"count") == 1001);
+  lob_free(one);
+  lob_free(snap);
+
+  util_trace_hook(NULL, NULL);
+  util_trace_reset();
+  snap = util_trace_snapshot();
+  fail_unless(lob_keys(snap) == 0);
+  lob_free(snap);
+
+#ifdef UTIL_TRACE
+  // a linked pair exercises the pipeline, every stage fires
+  memset(hooked, 0, sizeof(hooked));
+  util_trace_hook(trace_count, &calls);
+  mesh_t meshA = mesh_new();
+  mesh_t meshB = mesh_new();
+  fail_unless(mesh_generate(meshA) && mesh_generate(meshB));
+  net_loopback_t pair = net_loopback_new(meshA,meshB);
+  fail_unless(pair);
+  link_t linkAB = link_get(meshA, meshB->id);
+  fail_unless(link_resync(linkAB));
+  fail_unless(link_up(linkAB));
+  lob_t open = lob_new();
+  lob_set(open,"type","test");
+  fail_unless(link_direct(linkAB, open));
+  fail_unless(hooked[UTIL_TRACE_mesh_receive]);
+  fail_unless(hooked[UTIL_TRACE_exchange_receive]);
+  fail_unless(hooked[UTIL_TRACE_lob_parse]);
+  fail_unless(hooked[UTIL_TRACE_link_receive]);
+  fail_unless(hooked[UTIL_TRACE_link_send]);
+  fail_unless(hooked[UTIL_TRACE_transport]);
+  snap = util_trace_snapshot();
+  LOG("trace %s",lob_json(snap));
+  one = lob_get_json(snap,"mesh_receive");
+  fail_unless(lob_get_uint(one,"count") == hooked[UTIL_TRACE_mesh_receive]);
+  lob_free(one);
+  lob_free(snap);
+  net_loopback_free(pair);
+
+  // batched delivery records the receive stages once per packet too
+  pair = net_loopback_queued(meshA,meshB);
+  fail_unless(pair);
+  net_loopback_process(pair, 0);
+  memset(hooked, 0, sizeof(hooked));
+  for(i = 0; i < 4; i++)
+  {
+    lob_t ping = lob_new();
+    lob_set(ping,"type","test");
+    link_direct(linkAB, ping);
+  }
+  fail_unless(!hooked[UTIL_TRACE_mesh_receive]);
+  fail_unless(net_loopback_process(pair, 0) >= 4);
+  fail_unless(hooked[UTIL_TRACE_mesh_receive] >= 4);
+  fail_unless(hooked[UTIL_TRACE_exchange_receive] >= 4);
+  fail_unless(hooked[UTIL_TRACE_link_receive] >= 4);
+  util_trace_hook(NULL, NULL);
+  net_loopback_free(pair);
+  mesh_free(meshA);
+  mesh_free(meshB);
+#endif
+
+  return 0;
+}
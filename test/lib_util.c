@@ -2,6 +2,15 @@
 #include "util.h"
 #include "unit_test.h"
 
+// util_unhex's lenient per-char mapping, anything not hex passes through
+static uint8_t nibble(char x)
+{
+  if(x >= '0' && x <= '9') return x - '0';
+  if(x >= 'A' && x <= 'F') return x - 'A' + 10;
+  if(x >= 'a' && x <= 'f') return x - 'a' + 10;
+  return x;
+}
+
 int main(int argc, char **argv)
 {
   char hex[32];
@@ -10,6 +19,61 @@ int main(int argc, char **argv)
 
   fail_unless(strcmp("666f6f20626172",util_hex(str,len,hex)) == 0);
 
+  // the vector blocks against a plain hex/unhex, every length and every byte value at every position
+  size_t bad = 0;
+  uint8_t raw[80], got[80], want[80];
+  char enc[161], mixed[161];
+  size_t i, j, n;
+  for(i = 0; i < sizeof(raw); i++) raw[i] = i * 37 + 11;
+  for(n = 1; n <= sizeof(raw); n++)
+  {
+    if(util_hex(raw, n, enc) != enc) bad++;
+    for(i = 0; i < n; i++) if(enc[i*2] != "0123456789abcdef"[raw[i] >> 4] || enc[i*2+1] != "0123456789abcdef"[raw[i] & 15]) bad++;
+    if(enc[n*2] != 0) bad++;
+    memset(got, 0, sizeof(got));
+    if(util_unhex(enc, n*2, got) != got) bad++;
+    if(memcmp(got, raw, n) != 0) bad++;
+  }
+  util_hex(raw, 40, enc);
+  for(i = 0; i < 72; i++) for(j = 1; j < 256; j++)
+  {
+    memcpy(mixed, enc, 81);
+    mixed[i] = j;
+    for(n = 0; n < 40; n++) want[n] = ((nibble(mixed[n*2]) * 16) & 0xF0) + (nibble(mixed[n*2+1]) & 0xF);
+    memset(got, 0, sizeof(got));
+    util_unhex(mixed, 80, got);
+    if(memcmp(got, want, 40) != 0) bad++;
+  }
+  fail_unless(bad == 0);
+
+  // disabled levels don't evaluate their arguments
+  int evals = 0;
+  util_sys_log_level(4);
+  LOG_DEBUG("not shown %d",evals++);
+  LOG_CRAZY("not shown %d",evals++);
+  fail_unless(evals == 0);
+  fail_unless(LOG_WARN("shown %d",evals++) == NULL);
+  fail_unless(evals == 1);
+  fail_unless(!util_sys_log_on(7,"../src/mesh.c"));
+
+  // a module can be turned up or down on its own
+  fail_unless(util_sys_log_module("mesh",7) == 0);
+  fail_unless(util_sys_log_module("lib_util",3) == 0);
+  fail_unless(util_sys_log_on(7,"../src/mesh.c"));
+  fail_unless(!util_sys_log_on(8,"../src/mesh.c"));
+  fail_unless(!util_sys_log_on(7,"../src/meshy.c"));
+  fail_unless(!util_sys_log_on(4,"lib_util.c"));
+  LOG_WARN("not shown %d",evals++);
+  fail_unless(evals == 1);
+  util_sys_logging(0);
+  fail_unless(!util_sys_log_on(3,"lib_util.c"));
+  util_sys_logging(1);
+  fail_unless(util_sys_log_module("a_module_name_too_long",7) != 0);
+  fail_unless(util_sys_log_module("lib_util",8) == 0);
+  util_sys_log_level(8);
+  LOG_CRAZY("shown %d",evals++);
+  fail_unless(evals == 2);
+
   uint64_t at = util_at();
   fail_unless(at > 0);
   sleep(1);
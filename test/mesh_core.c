@@ -6,6 +6,16 @@ link_t net_send(link_t link, lob_t packet, void *arg)
   return link;
 }
 
+// counts what it's sent, refuses everything when the count is NULL
+link_t net_count(link_t link, lob_t packet, void *arg)
+{
+  if(!packet) return link;
+  if(!arg) return NULL;
+  (*(int*)arg)++;
+  lob_free(packet);
+  return link;
+}
+
 link_t net_test(link_t link, lob_t path)
 {
   fail_unless(path);
@@ -46,6 +56,51 @@ int main(int argc, char **argv)
   link = mesh_path(mesh,link,lob_set(lob_new(),"type","test"));
   fail_unless(link);
   
+  // a second pipe gets the handshake and then whatever is faster
+  int fast = 0, slow = 0;
+  fail_unless(link_unpipe(link, net_send, NULL) == link);
+  fail_unless(link->pipes_len == 0);
+  fail_unless(link_pipe(link, net_count, &slow) == link);
+  fail_unless(link_pipe(link, net_count, &fast) == link);
+  fail_unless(slow == 1 && fast == 1);
+  fail_unless(link->pipes_len == 2);
+  fail_unless(link_pipe_rtt(link_pipe_get(link, net_count, &slow), 80));
+  fail_unless(link_pipe_rtt(link_pipe_get(link, net_count, &fast), 10));
+  fail_unless(link_pipe_best(link) == link_pipe_get(link, net_count, &fast));
+  fail_unless(link_send(link, lob_new()) == link);
+  fail_unless(fast == 2 && slow == 1);
+
+  // one that refuses a send is skipped for the next best until it's heard from
+  fail_unless(link_pipe(link, net_count, NULL) == NULL);
+  fail_unless(link_pipe_get(link, net_count, NULL)->failed);
+  fail_unless(link_pipe_rtt(link_pipe_get(link, net_count, NULL), 1));
+  fail_unless(link_send(link, lob_new()) == link);
+  fail_unless(fast == 3);
+  fail_unless(link_pipe(link, net_count, NULL) == link);
+  fail_unless(!link_pipe_get(link, net_count, NULL)->failed);
+  fail_unless(link_unpipe(link, net_count, NULL) == link);
+
+  // one that's gone quiet past its timeout is failed over from
+  link_pipe_get(link, net_count, &fast)->waiting -= LINK_PIPE_TIMEOUT + 1;
+  fail_unless(link_pipe_best(link) == link_pipe_get(link, net_count, &slow));
+  fail_unless(link_pipe_get(link, net_count, &fast)->failed);
+  fail_unless(link_pipe_get(link, net_count, &fast)->loss > 0);
+  fail_unless(link_send(link, lob_new()) == link);
+  fail_unless(slow == 2 && fast == 3);
+
+  // and is back once it answers
+  fail_unless(link_pipe(link, net_count, &fast) == link);
+  fail_unless(link_pipe_best(link) == link_pipe_get(link, net_count, &fast));
+
+  // past the limit the failed one is replaced
+  int more[LINK_PIPES];
+  memset(more,0,sizeof(more));
+  link_pipe_get(link, net_count, &slow)->failed = 1;
+  for(int i = 0; i < LINK_PIPES - 1; i++) fail_unless(link_pipe(link, net_count, &more[i]) == link);
+  fail_unless(link->pipes_len == LINK_PIPES);
+  fail_unless(!link_pipe_get(link, net_count, &slow));
+  fail_unless(link_pipe_get(link, net_count, &fast));
+
   fail_unless(strlen(lob_json(mesh_json(mesh))) > 10);
   LOG("json %s",lob_json(lob_array(mesh_links(mesh))));
   fail_unless(strlen(lob_json(lob_array(mesh_links(mesh)))) > 10);
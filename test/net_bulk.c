@@ -85,6 +85,39 @@ int main(int argc, char **argv)
   
   LOG("bulked %d",bulked);
   fail_unless(bulked == i+1);
+
+  // a whole list of decrypted packets at once
+  lob_t inners = NULL;
+  for(i=0;i<10;i++)
+  {
+    lob_t bulk = lob_new();
+    lob_set_uint(bulk,"c",cid);
+    inners = lob_push(inners, bulk);
+  }
+  bulked = 0;
+  fail_unless(link_receive_batch(linkAB, inners));
+  fail_unless(bulked == 10);
+
+  // encrypted ones through the mesh, with a runt in the middle that must not stall the rest
+  lob_t packets[12];
+  for(i=0;i<12;i++)
+  {
+    if(i == 5)
+    {
+      packets[i] = lob_new();
+      lob_body(packets[i],(uint8_t*)"runt",4);
+      continue;
+    }
+    lob_t bulk = lob_new();
+    lob_set_uint(bulk,"c",cid);
+    packets[i] = e3x_exchange_send(linkBA->x, bulk);
+    lob_free(bulk);
+    fail_unless(packets[i]);
+  }
+  bulked = 0;
+  fail_unless(mesh_receive_batch(meshA, packets, 12) == linkAB);
+  fail_unless(bulked == 11);
+  fail_unless(!packets[0] && !packets[11]);
   
   mesh_free(meshA);
   mesh_free(meshB);
@@ -1,8 +1,65 @@
+#include <pthread.h>
 #include "net_loopback.h"
 #include "unit_test.h"
 
 static uint8_t status = 0;
 
+// a private pair of meshes per thread, linked and torn down a few times
+static void *mesh_thread(void *arg)
+{
+  intptr_t ok = 0;
+  int i;
+  for(i = 0; i < 4; i++)
+  {
+    mesh_t a = mesh_new();
+    mesh_t b = mesh_new();
+    if(!a || !b || !mesh_generate(a) || !mesh_generate(b)) break;
+    net_loopback_t pair = net_loopback_new(a,b);
+    link_t ab = link_get(a, b->id);
+    link_t ba = link_get(b, a->id);
+    if(pair && link_resync(ab) && link_up(ab) && link_up(ba) && mesh_linked(a, hashname_char(b->id), 0) == ab) ok++;
+    net_loopback_free(pair);
+    mesh_free(a);
+    mesh_free(b);
+  }
+  return (void*)ok;
+}
+
+// reads everything so an end is noticed
+static void chan_drain(chan_t c, void *arg)
+{
+  lob_t packet;
+  while((packet = chan_receiving(c))) lob_free(packet);
+}
+
+// bounces everything back until it's been around enough times
+static uint32_t bounces = 0;
+static void chan_bounce(chan_t c, void *arg)
+{
+  lob_t packet;
+  while((packet = chan_receiving(c)))
+  {
+    if(lob_get(packet,"type") || ++bounces >= 1000)
+    {
+      lob_free(packet);
+      continue;
+    }
+    lob_t next = chan_packet(c);
+    lob_body(next, lob_body_get(packet), lob_body_len(packet));
+    lob_free(packet);
+    chan_send(c, next);
+  }
+}
+
+static lob_t bounce_open(link_t link, lob_t open)
+{
+  if(lob_get_cmp(open,"type","bounce")) return open;
+  chan_t c = link_chan(link, open);
+  chan_handle(c, chan_bounce, NULL);
+  chan_receive(c, open);
+  return NULL;
+}
+
 void link_check(link_t link)
 {
   status = link_up(link) ? 1 : 0;
@@ -11,6 +68,18 @@ void link_check(link_t link)
 
 int main(int argc, char **argv)
 {
+  // independent meshes on separate threads, first so they're the ones doing the first hashing (and sha256 back-end
+  // pick), only the process-wide init comes before
+  pthread_t threads[4];
+  void *ok;
+  int i, linked = 0;
+  fail_unless(e3x_init(NULL) == 0);
+  util_sys_logging(0);
+  for(i = 0; i < 4; i++) fail_unless(pthread_create(&threads[i], NULL, mesh_thread, NULL) == 0);
+  for(i = 0; i < 4; i++) if(pthread_join(threads[i], &ok) == 0) linked += (intptr_t)ok;
+  util_sys_logging(1);
+  fail_unless(linked == 16);
+
   mesh_t meshA = mesh_new();
   fail_unless(meshA);
   mesh_on_link(meshA, "test", link_check); // testing the event being triggered
@@ -34,7 +103,44 @@ int main(int argc, char **argv)
   fail_unless(link_up(linkAB));
   fail_unless(link_up(linkBA));
   fail_unless(status);
-  
+
+  // everything one side sent the other received, and the mesh totals include the link's
+  lob_t statsAB = link_stats(linkAB);
+  lob_t statsA = mesh_stats(meshA);
+  lob_t statsB = mesh_stats(meshB);
+  fail_unless(statsAB && statsA && statsB);
+  fail_unless(lob_get_uint(statsAB,"packets_out") >= 1);
+  fail_unless(lob_get_uint(statsAB,"handshakes_ok") >= 1);
+  fail_unless(lob_get_uint(statsB,"handshakes_ok") >= 1);
+  fail_unless(lob_get_uint(statsAB,"packets_out") == lob_get_uint(statsB,"packets_in"));
+  fail_unless(lob_get_uint(statsAB,"bytes_out") == lob_get_uint(statsB,"bytes_in"));
+  fail_unless(lob_get_uint(statsA,"bytes_out") == lob_get_uint(statsAB,"bytes_out"));
+  fail_unless(lob_get_uint(statsA,"drop_short") == 0);
+  lob_free(statsAB);
+  lob_free(statsA);
+  lob_free(statsB);
+
+  // drops are counted by reason
+  lob_t runt = lob_new();
+  lob_body(runt,(uint8_t*)"short",5);
+  fail_unless(!mesh_receive(meshA, runt));
+  statsA = mesh_stats(meshA);
+  fail_unless(lob_get_uint(statsA,"drop_short") == 1);
+  lob_free(statsA);
+
+  // channels are counted as they come and go
+  lob_t open = lob_new();
+  lob_set(open,"type","test");
+  chan_t c = link_chan(linkAB, open);
+  fail_unless(c);
+  chan_handle(c, chan_drain, NULL);
+  chan_err(c, "done");
+  fail_unless(link_process(linkAB, 1));
+  statsAB = link_stats(linkAB);
+  fail_unless(lob_get_uint(statsAB,"chan_open") == 1);
+  fail_unless(lob_get_uint(statsAB,"chan_close") == 1);
+  lob_free(statsAB);
+
   fail_unless(mesh_process(meshA,1));
   fail_unless(mesh_linked(meshA, hashname_char(meshB->id),0));
   fail_unless(mesh_unlink(linkAB));
@@ -42,6 +148,44 @@ int main(int argc, char **argv)
   fail_unless(!mesh_linked(meshA, hashname_char(meshB->id),0));
   fail_unless(!status);
 
+  // queued, nothing arrives until it's processed
+  mesh_t meshC = mesh_new();
+  mesh_t meshD = mesh_new();
+  fail_unless(mesh_generate(meshC) && mesh_generate(meshD));
+  mesh_on_open(meshD, "bounce", bounce_open);
+  net_loopback_t queue = net_loopback_queued(meshC, meshD);
+  fail_unless(queue);
+  link_t linkCD = link_get(meshC, meshD->id);
+  link_t linkDC = link_get(meshD, meshC->id);
+  fail_unless(linkCD && linkDC);
+  fail_unless(queue->to_a_len == 1 && queue->to_b_len == 1);
+  fail_unless(!link_up(linkCD));
+  fail_unless(net_loopback_process(queue, 1) == 2);
+  fail_unless(net_loopback_process(queue, 0) >= 2);
+  fail_unless(!queue->to_a && !queue->to_b);
+  fail_unless(link_up(linkCD) && link_up(linkDC));
+
+  // a long exchange of replies stays flat instead of recursing
+  lob_t bounce = lob_new();
+  lob_set(bounce,"type","bounce");
+  chan_t cb = link_chan(linkCD, bounce);
+  chan_handle(cb, chan_bounce, NULL);
+  chan_send(cb, lob_copy(bounce));
+  lob_t first = chan_packet(cb);
+  lob_body(first, (uint8_t*)"ping", 4);
+  chan_send(cb, first);
+  fail_unless(queue->to_b_len == 2);
+  fail_unless(net_loopback_process(queue, 0) >= 1000);
+  fail_unless(bounces == 1000);
+
+  // whatever is still queued goes with the pair
+  fail_unless(link_resync(linkCD));
+  fail_unless(queue->to_b_len == 1);
+  net_loopback_free(queue);
+  mesh_free(meshC);
+  mesh_free(meshD);
+  lob_free(bounce);
+
   return 0;
 }
 
@@ -0,0 +1,137 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include "net_shm.h"
+#include "unit_test.h"
+
+// the other process, echoes channel packets until the parent is done with it
+static uint32_t echoed = 0;
+static void chan_echo(chan_t c, void *arg)
+{
+  lob_t packet;
+  while((packet = chan_receiving(c)))
+  {
+    if(lob_get(packet,"type"))
+    {
+      lob_free(packet);
+      continue;
+    }
+    echoed++;
+    lob_t back = chan_packet(c);
+    lob_body(back, lob_body_get(packet), lob_body_len(packet));
+    lob_free(packet);
+    chan_send(c, back);
+  }
+}
+
+static lob_t echo_open(link_t link, lob_t open)
+{
+  if(lob_get_cmp(open,"type","echo")) return open;
+  chan_t c = link_chan(link, open);
+  chan_handle(c, chan_echo, NULL);
+  chan_receive(c, open);
+  return NULL;
+}
+
+static uint32_t back = 0;
+static void chan_back(chan_t c, void *arg)
+{
+  lob_t packet;
+  while((packet = chan_receiving(c)))
+  {
+    if(lob_body_len(packet) == 1000) back++;
+    lob_free(packet);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  char name[64];
+  int i, status;
+  snprintf(name, sizeof(name), "/telehash-test-%d", (int)getpid());
+
+  fail_unless(!e3x_init(NULL));
+  lob_t secretsA = e3x_generate();
+  lob_t secretsB = e3x_generate();
+  fail_unless(secretsA && secretsB);
+  lob_t options = lob_new();
+  lob_set(options,"name",name);
+  lob_set_uint(options,"size",8192);
+
+  // one mesh here and one in a child, the child can only come in second
+  mesh_t meshA = mesh_new();
+  fail_unless(!mesh_load(meshA, secretsA, lob_linked(secretsA)));
+  net_shm_t netA = net_shm_new(meshA, options);
+  fail_unless(netA);
+
+  pid_t child = fork();
+  fail_unless(child >= 0);
+  if(!child)
+  {
+    util_sys_logging(0);
+    mesh_t meshB = mesh_new();
+    mesh_load(meshB, secretsB, lob_linked(secretsB));
+    mesh_on_open(meshB, "echo", echo_open);
+    net_shm_t netB = net_shm_new(meshB, options);
+    if(!netB || !net_shm_link(netB, link_get_keys(meshB, lob_linked(secretsA)))) _exit(1);
+    for(i = 0; i < 5000 && echoed < 20; i++) if(net_shm_wait(netB, 10)) net_shm_process(netB);
+    net_shm_free(netB);
+    mesh_free(meshB);
+    _exit(echoed == 20 ? 0 : 2);
+  }
+
+  link_t linkAB = link_get_keys(meshA, lob_linked(secretsB));
+  fail_unless(linkAB);
+  fail_unless(net_shm_link(netA, linkAB));
+  for(i = 0; i < 500 && !link_up(linkAB); i++) if(net_shm_wait(netA, 10)) net_shm_process(netA);
+  fail_unless(link_up(linkAB));
+
+  // with both sides there a third can't join
+  mesh_t meshC = mesh_new();
+  fail_unless(!net_shm_new(meshC, options));
+
+  // packets bigger than an eighth of the ring each way, so it wraps
+  lob_t open = lob_new();
+  lob_set(open,"type","echo");
+  chan_t c = link_chan(linkAB, open);
+  chan_handle(c, chan_back, NULL);
+  chan_send(c, lob_copy(open));
+  for(i = 0; i < 20; i++)
+  {
+    lob_t packet = chan_packet(c);
+    lob_body(packet, NULL, 1000);
+    chan_send(c, packet);
+    for(status = 0; status < 500 && back < (uint32_t)i + 1; status++) if(net_shm_wait(netA, 10)) net_shm_process(netA);
+  }
+  fail_unless(back == 20);
+
+  fail_unless(waitpid(child, &status, 0) == child);
+  fail_unless(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  // the child is gone and nobody is reading, so the ring fills and sends fail
+  for(i = 0; i < 20; i++)
+  {
+    lob_t packet = lob_new();
+    lob_body(packet, NULL, 1000);
+    if(!link_send(linkAB, packet)) break;
+  }
+  fail_unless(i < 20);
+  lob_t stats = link_stats(linkAB);
+  fail_unless(lob_get_uint(stats,"drop_delivery") == 1);
+  lob_free(stats);
+
+  net_shm_free(netA);
+  mesh_free(meshA);
+  mesh_free(meshC);
+  lob_free(open);
+  lob_free(secretsA);
+  lob_free(secretsB);
+
+  // the name went with the creator, so it's a fresh start
+  meshC = mesh_new();
+  fail_unless((netA = net_shm_new(meshC, options)));
+  net_shm_free(netA);
+  mesh_free(meshC);
+  lob_free(options);
+
+  return 0;
+}
@@ -0,0 +1,244 @@
+#include "net_sim.h"
+#include "unit_test.h"
+
+#define RING 32
+
+static lob_t secrets[RING];
+
+// a ring of meshes over the same path, returns how many links came up
+static uint32_t ring(uint64_t seed, net_sim_path_s *path, uint64_t *sent)
+{
+  mesh_t meshes[RING];
+  net_sim_t sim = net_sim_new(seed);
+  uint32_t i, up = 0;
+  for(i = 0; i < RING; i++)
+  {
+    meshes[i] = mesh_new();
+    mesh_load(meshes[i], secrets[i], lob_linked(secrets[i]));
+  }
+  for(i = 0; i < RING; i++) net_sim_link(sim, meshes[i], meshes[(i + 1) % RING], path);
+  net_sim_run(sim, 10000000);
+  for(i = 0; i < RING; i++) if(link_up(link_get(meshes[i], meshes[(i + 1) % RING]->id))) up++;
+  if(sent) net_sim_stats(sim, sent, NULL, NULL);
+  for(i = 0; i < RING; i++) mesh_free(meshes[i]);
+  net_sim_free(sim);
+  return up;
+}
+
+// counts what arrives on a reliable channel, each should be the next one
+static uint32_t counted = 0;
+static uint8_t in_order = 1;
+static void chan_count(chan_t c, void *arg)
+{
+  lob_t packet;
+  while((packet = chan_receiving(c)))
+  {
+    if(lob_get_uint(packet,"n") != counted) in_order = 0;
+    counted++;
+    lob_free(packet);
+  }
+}
+
+static lob_t count_open(link_t link, lob_t open)
+{
+  chan_t c;
+  if(lob_get_cmp(open,"type","count")) return open;
+  c = link_chan(link, open);
+  chan_handle(c, chan_count, NULL);
+  chan_receive(c, open);
+  return NULL;
+}
+
+// reads only once it's told to, and remembers the most it ever had waiting
+static uint8_t reading = 0;
+static uint32_t waiting = 0, taken = 0;
+static void chan_slow(chan_t c, void *arg)
+{
+  lob_t packet;
+  if(chan_readable(c) > waiting) waiting = chan_readable(c);
+  while(reading && (packet = chan_receiving(c)))
+  {
+    if(lob_get_uint(packet,"n") != taken) in_order = 0;
+    taken++;
+    lob_free(packet);
+  }
+}
+
+static lob_t slow_open(link_t link, lob_t open)
+{
+  chan_t c;
+  if(lob_get_cmp(open,"type","slow")) return open;
+  c = link_chan(link, open);
+  chan_buffer(c, 4);
+  chan_handle(c, chan_slow, NULL);
+  chan_receive(c, open);
+  return NULL;
+}
+
+// keeps it full until there's nothing left to send
+static uint32_t sending = 0, writable = 0;
+static void chan_more(chan_t c, void *arg)
+{
+  writable++;
+  while(sending < 100 && chan_writable(c))
+  {
+    lob_t packet = chan_packet(c);
+    lob_set_uint(packet,"n",++sending);
+    chan_send(c, packet);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  mesh_t meshA = mesh_new();
+  mesh_t meshB = mesh_new();
+  fail_unless(mesh_generate(meshA));
+  fail_unless(mesh_generate(meshB));
+
+  // nothing arrives until the clock gets there
+  net_sim_path_s path = {.latency = 20000};
+  net_sim_t sim = net_sim_new(42);
+  fail_unless(sim);
+  fail_unless(net_sim_link(sim, meshA, meshB, &path));
+  link_t linkAB = link_get(meshA, meshB->id);
+  link_t linkBA = link_get(meshB, meshA->id);
+  fail_unless(linkAB && linkBA);
+  fail_unless(net_sim_pending(sim) == 2);
+  fail_unless(!link_up(linkAB));
+  fail_unless(net_sim_run(sim, 19999) == 0);
+  fail_unless(net_sim_run(sim, 20000) == 2);
+  fail_unless(net_sim_now(sim) == 20000);
+
+  // the crossing handshakes settle on the next round trip
+  fail_unless(net_sim_run(sim, 40000) > 0);
+  fail_unless(link_up(linkAB) && link_up(linkBA));
+
+  // a second of virtual time passes without any waiting
+  fail_unless(net_sim_run(sim, 1000000) == 0);
+  fail_unless(net_sim_now(sim) == 1000000);
+  fail_unless(mesh_linked(meshA, hashname_char(meshB->id), 0));
+
+  // a packet takes its size over the bandwidth to get on the wire, and the next one waits behind it
+  net_sim_free(sim);
+  sim = net_sim_new(42);
+  path.latency = 0;
+  path.bandwidth = 1000;
+  fail_unless(net_sim_link(sim, meshA, meshB, &path));
+  link_resync(linkAB);
+  fail_unless(net_sim_step(sim) == 1);
+  fail_unless(net_sim_now(sim) >= 100000); // handshakes are well over 100 bytes
+  uint64_t first = net_sim_now(sim);
+  fail_unless(net_sim_step(sim) == 1);
+  fail_unless(net_sim_now(sim) >= first);
+  net_sim_run(sim, 10000000);
+  fail_unless(link_up(linkAB));
+  net_sim_free(sim);
+
+  // a reliable channel gets everything over a lossy reordering path once each and in order, resends are on the
+  // sim's clock so each run gives them time to fire
+  sim = net_sim_new(42);
+  fail_unless(net_sim_link(sim, meshA, meshB, NULL));
+  link_resync(linkAB);
+  net_sim_run(sim, 1000);
+  fail_unless(link_up(linkAB) && link_up(linkBA));
+  net_sim_path_s drops = {.latency = 5000, .jitter = 5000, .loss = 100000, .reorder = 100000};
+  fail_unless(net_sim_path(sim, meshA, meshB, &drops));
+  mesh_on_open(meshB, "count", count_open);
+  lob_t open = lob_new();
+  lob_set(open,"type","count");
+  lob_set_uint(open,"c",e3x_exchange_cid(linkAB->x, NULL));
+  lob_set_uint(open,"n",0);
+  chan_t c = link_chan(linkAB, open);
+  fail_unless(chan_reliable(c, 16));
+  fail_unless(chan_send(c, lob_copy(open)));
+  lob_free(open);
+  uint32_t n, sent = 0;
+  for(n = 0; n < 100 && counted <= 200; n++)
+  {
+    while(sent < 200 && chan_writable(c))
+    {
+      lob_t packet = chan_packet(c);
+      lob_set_uint(packet,"n",++sent);
+      fail_unless(chan_send(c, packet));
+    }
+    net_sim_run(sim, net_sim_now(sim) + 1000000);
+  }
+  fail_unless(counted == 201);
+  fail_unless(in_order);
+  fail_unless(lob_get_uint(link_stats(linkAB),"chan_resend") > 0);
+  net_sim_free(sim);
+
+  // a reader that doesn't keep up closes the window, the sender is refused past it and told when it opens again
+  sim = net_sim_new(42);
+  fail_unless(net_sim_link(sim, meshA, meshB, NULL));
+  mesh_on_open(meshB, "slow", slow_open);
+  open = lob_new();
+  lob_set(open,"type","slow");
+  lob_set_uint(open,"c",e3x_exchange_cid(linkAB->x, NULL));
+  lob_set_uint(open,"n",0);
+  c = link_chan(linkAB, open);
+  fail_unless(chan_reliable(c, 4));
+  chan_on_writable(c, chan_more);
+  fail_unless(chan_send(c, lob_copy(open)));
+  lob_free(open);
+  while(chan_writable(c))
+  {
+    lob_t packet = chan_packet(c);
+    lob_set_uint(packet,"n",++sending);
+    fail_unless(chan_send(c, packet));
+    net_sim_run(sim, net_sim_now(sim) + 1000);
+  }
+  fail_unless(!chan_send(c, chan_packet(c)));
+  net_sim_run(sim, net_sim_now(sim) + 1000000);
+  fail_unless(waiting == 4 && taken == 0 && !writable);
+  in_order = 1;
+  reading = 1;
+  for(n = 0; n < 100 && taken <= 100; n++)
+  {
+    net_sim_run(sim, net_sim_now(sim) + 1000000);
+  }
+  fail_unless(taken == 101 && in_order);
+  fail_unless(writable > 0 && waiting == 4);
+  net_sim_free(sim);
+  mesh_free(meshA);
+  mesh_free(meshB);
+
+  // many meshes at once, same keys and seed same run, everything lost nothing linked
+  util_sys_logging(0);
+  uint32_t i;
+  for(i = 0; i < RING; i++) fail_unless((secrets[i] = e3x_generate()));
+  uint64_t sent1 = 0, sent2 = 1;
+  net_sim_path_s lossy = {.latency = 5000, .jitter = 5000, .loss = 100000, .reorder = 100000, .bandwidth = 1000000};
+  fail_unless(ring(7, &lossy, &sent1) > RING / 2);
+  fail_unless(ring(7, &lossy, &sent2) > RING / 2);
+  fail_unless(sent1 == sent2);
+  net_sim_path_s lost = {.loss = 1000000};
+  fail_unless(ring(7, &lost, NULL) == 0);
+  net_sim_path_s clean = {.latency = 1000};
+  fail_unless(ring(7, &clean, NULL) == RING);
+
+  // a mesh freed with packets still on their way to it, they and anything sent to it later are dropped
+  uint64_t dropped = 0;
+  sim = net_sim_new(3);
+  meshA = mesh_new();
+  meshB = mesh_new();
+  mesh_load(meshA, secrets[0], lob_linked(secrets[0]));
+  mesh_load(meshB, secrets[1], lob_linked(secrets[1]));
+  fail_unless(net_sim_link(sim, meshA, meshB, NULL));
+  fail_unless(net_sim_pending(sim) == 2);
+  linkAB = link_get(meshA, meshB->id);
+  mesh_free(meshB);
+  fail_unless(net_sim_pending(sim) == 0);
+  link_resync(linkAB);
+  fail_unless(net_sim_pending(sim) == 0);
+  net_sim_run(sim, 1000000);
+  net_sim_stats(sim, NULL, NULL, &dropped);
+  fail_unless(dropped >= 2);
+  mesh_free(meshA);
+  net_sim_free(sim);
+
+  for(i = 0; i < RING; i++) lob_free(secrets[i]);
+  util_sys_logging(1);
+
+  return 0;
+}
@@ -1,7 +1,30 @@
+#include <unistd.h>
 #include "net_udp4.h"
 #include "util_sys.h"
 #include "unit_test.h"
 
+// remembers the biggest body that came in on a channel
+static uint32_t biggest = 0;
+static void chan_sized(chan_t c, void *arg)
+{
+  lob_t packet;
+  while((packet = chan_receiving(c)))
+  {
+    if(packet->body_len > biggest) biggest = packet->body_len;
+    lob_free(packet);
+  }
+}
+
+static lob_t sized_open(link_t link, lob_t open)
+{
+  chan_t c;
+  if(lob_get_cmp(open,"type","sized")) return open;
+  c = link_chan(link, open);
+  chan_handle(c, chan_sized, NULL);
+  chan_receive(c, open);
+  return NULL;
+}
+
 int main(int argc, char **argv)
 {
   mesh_t meshA = mesh_new();
@@ -40,6 +63,89 @@ int main(int argc, char **argv)
   fail_unless(i);
   LOG_DEBUG("done in %d loops",32-i);
 
+  // until probing finds out otherwise a pipe is only trusted with the minimum
+  fail_unless(link_mtu(linkAB) == (uint32_t)(NET_UDP4_MTU_MIN - linkAB->x->cs->overhead));
+
+  // loopback carries far more
+  for(i=1000;i;i--)
+  {
+    net_udp4_process(netA);
+    net_udp4_process(netB);
+    if(net_udp4_mtu(netA,"127.0.0.1",net_udp4_port(netB)) > NET_UDP4_MTU_MAX - 16) break;
+  }
+  fail_unless(i);
+  uint32_t mtu = net_udp4_mtu(netA,"127.0.0.1",net_udp4_port(netB));
+  fail_unless(link_pipe_best(linkAB)->mtu == mtu);
+  fail_unless(link_mtu(linkAB) == mtu - linkAB->x->cs->overhead);
+
+  // a channel packet sized to fit goes over whole
+  mesh_on_open(meshB, "sized", sized_open);
+  lob_t open = lob_new();
+  lob_set(open,"type","sized");
+  lob_set_uint(open,"c",e3x_exchange_cid(linkAB->x, NULL));
+  chan_t c = link_chan(linkAB, open);
+  fail_unless(c);
+  fail_unless(chan_send(c, lob_copy(open)));
+  lob_free(open);
+  uint32_t body = chan_mtu(c);
+  fail_unless(body > NET_UDP4_MTU_MIN && body < link_mtu(linkAB));
+  lob_t packet = chan_packet(c);
+  lob_body(packet, NULL, body);
+  fail_unless(lob_len(packet) == link_mtu(linkAB));
+  fail_unless(chan_send(c, packet));
+  for(i=32;i && biggest != body;i--) net_udp4_process(netB);
+  fail_unless(biggest == body);
+
+  // a peer that only does util_frames (a header datagram then the packet) gets them framed and its framed ones come in
+  mesh_t meshC = mesh_new();
+  fail_unless(mesh_generate(meshC));
+  int sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  struct sockaddr_in sa;
+  socklen_t salen = sizeof(sa);
+  memset(&sa,0,sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  fail_unless(sock >= 0 && bind(sock, (struct sockaddr*)&sa, salen) == 0);
+  fail_unless(getsockname(sock, (struct sockaddr*)&sa, &salen) == 0);
+  util_sock_timeout(sock,1000);
+  uint8_t frame[1280];
+  uint32_t magic, len;
+  lob_t hello = lob_new();
+  lob_set(hello,"hello","world");
+  fail_unless(net_udp4_direct(netA, lob_copy(hello), "127.0.0.1", ntohs(sa.sin_port)));
+  fail_unless(recv(sock, frame, sizeof(frame), 0) == 8);
+  memcpy(&magic, frame, 4);
+  memcpy(&len, frame + 4, 4);
+  fail_unless(magic == 1280 && len == lob_len(hello));
+  fail_unless(recv(sock, frame, sizeof(frame), 0) == (ssize_t)len);
+  fail_unless(memcmp(frame, lob_raw(hello), len) == 0);
+  lob_free(hello);
+  link_t linkAC = link_get_keys(meshA, meshC->keys);
+  link_t linkCA = link_get_keys(meshC, meshA->keys);
+  fail_unless(linkAC && linkCA);
+  lob_t handshake = link_handshake(linkCA);
+  struct sockaddr_in to;
+  memset(&to,0,sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  to.sin_port = htons(net_udp4_port(netA));
+  len = lob_len(handshake);
+  memcpy(frame, &magic, 4);
+  memcpy(frame + 4, &len, 4);
+  fail_unless(sendto(sock, frame, 8, 0, (struct sockaddr*)&to, sizeof(to)) == 8);
+  fail_unless(sendto(sock, lob_raw(handshake), len, 0, (struct sockaddr*)&to, sizeof(to)) == (ssize_t)len);
+  lob_free(handshake);
+  for(i=32;i && !link_pipe_best(linkAC);i--) net_udp4_process(netA);
+  fail_unless(link_pipe_best(linkAC));
+  fail_unless(net_udp4_mtu(netA,"127.0.0.1",ntohs(sa.sin_port)) == NET_UDP4_MTU_MIN);
+  close(sock);
+  mesh_free(meshC);
+
+  net_udp4_free(netA);
+  net_udp4_free(netB);
+  mesh_free(meshA);
+  mesh_free(meshB);
+
   return 0;
 }
 
@@ -0,0 +1,133 @@
+#include <unistd.h>
+#include "net_unix.h"
+#include "unit_test.h"
+
+// sizes of everything that arrived
+static uint32_t got = 0;
+static size_t sizes[64];
+static void chan_got(chan_t c, void *arg)
+{
+  lob_t packet;
+  while((packet = chan_receiving(c)))
+  {
+    if(!lob_get(packet,"type") && got < 64) sizes[got++] = lob_body_len(packet);
+    lob_free(packet);
+  }
+}
+
+static lob_t got_open(link_t link, lob_t open)
+{
+  if(lob_get_cmp(open,"type","got")) return open;
+  chan_t c = link_chan(link, open);
+  chan_handle(c, chan_got, NULL);
+  chan_receive(c, open);
+  return NULL;
+}
+
+static void both(net_unix_t a, net_unix_t b)
+{
+  int i;
+  for(i = 0; i < 10; i++)
+  {
+    net_unix_process(a);
+    net_unix_process(b);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  char pathA[64], pathB[64];
+  snprintf(pathA, sizeof(pathA), "/tmp/telehash-test-%d-a.sock", (int)getpid());
+  snprintf(pathB, sizeof(pathB), "/tmp/telehash-test-%d-b.sock", (int)getpid());
+
+  mesh_t meshA = mesh_new();
+  mesh_t meshB = mesh_new();
+  fail_unless(mesh_generate(meshA) && mesh_generate(meshB));
+  mesh_on_open(meshB, "got", got_open);
+
+  lob_t options = lob_new();
+  lob_set(options,"path",pathA);
+  net_unix_t netA = net_unix_new(meshA, options);
+  fail_unless(netA);
+  fail_unless(net_unix_socket(netA) > 0);
+  fail_unless(strcmp(net_unix_path(netA), pathA) == 0);
+  fail_unless(access(pathA, F_OK) == 0);
+  lob_set(options,"path",pathB);
+  net_unix_t netB = net_unix_new(meshB, options);
+  fail_unless(netB);
+
+  // B knows A and answers its handshake over the pipe it came in on
+  link_t linkAB = link_get_keys(meshA, meshB->keys);
+  fail_unless(link_get_keys(meshB, meshA->keys));
+  fail_unless(net_unix_link(netA, linkAB, pathB));
+  both(netA, netB);
+  fail_unless(link_up(linkAB));
+  fail_unless(link_up(link_get(meshB, meshA->id)));
+
+  // more than a batch at once, and ones too big to go inline that go by memfd
+  lob_t open = lob_new();
+  lob_set(open,"type","got");
+  chan_t c = link_chan(linkAB, open);
+  chan_send(c, lob_copy(open));
+  int i;
+  for(i = 0; i < 40; i++)
+  {
+    lob_t packet = chan_packet(c);
+    lob_body(packet, NULL, (i == 20) ? 200000 : 100 + i);
+    chan_send(c, packet);
+  }
+  both(netA, netB);
+  fail_unless(got == 40);
+  fail_unless(sizes[0] == 100 && sizes[39] == 139);
+  fail_unless(sizes[20] == 200000);
+
+  // without memfd they're refused when sent
+  net_unix_free(netA);
+  lob_set(options,"path",pathA);
+  lob_set_uint(options,"memfd",0);
+  netA = net_unix_new(meshA, options);
+  fail_unless(netA);
+  fail_unless(net_unix_link(netA, linkAB, pathB));
+  lob_t big = lob_new();
+  lob_body(big, NULL, 100000);
+  fail_unless(!link_send(linkAB, big));
+
+  // a socket that never reads only holds back what's going to it, and only so much waits for it
+  char pathC[64];
+  snprintf(pathC, sizeof(pathC), "/tmp/telehash-test-%d-c.sock", (int)getpid());
+  struct sockaddr_un sa;
+  memset(&sa,0,sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  strcpy(sa.sun_path,pathC);
+  unlink(pathC);
+  int stuck = socket(AF_UNIX, SOCK_DGRAM, 0);
+  fail_unless(stuck >= 0 && bind(stuck, (struct sockaddr*)&sa, sizeof(sa)) == 0);
+  for(i = 0; i < 40; i++)
+  {
+    lob_t packet = lob_new();
+    lob_body(packet, NULL, 100);
+    fail_unless(net_unix_direct(netA, packet, pathC));
+  }
+  lob_t packet = chan_packet(c);
+  lob_body(packet, NULL, 42);
+  chan_send(c, packet);
+  both(netA, netB);
+  fail_unless(got == 41 && sizes[40] == 42);
+  for(i = 0; i <= NET_UNIX_QUEUE && net_unix_direct(netA, lob_new(), pathC); i++);
+  fail_unless(i <= NET_UNIX_QUEUE);
+  close(stuck);
+  unlink(pathC);
+
+  // gone with the transport
+  net_unix_free(netA);
+  net_unix_free(netB);
+  fail_unless(access(pathA, F_OK) != 0);
+  fail_unless(access(pathB, F_OK) != 0);
+
+  mesh_free(meshA);
+  mesh_free(meshB);
+  lob_free(open);
+  lob_free(options);
+
+  return 0;
+}